@@ -11,19 +11,29 @@ struct Material {
 };
 
 in vec3 FragPos;
-in vec3 Normal;
+flat in vec3 Normal;
 in vec2 TexCoord;
+flat in vec2 TileOrigin;
 
 out vec4 FragColor;
 
-uniform vec3 viewPos;
+// Per-frame camera data, see CameraUniforms in camera.hpp.
+layout (std140, binding = 0) uniform Camera
+{
+    mat4 viewProjection;
+    vec4 viewPos;
+};
+
 uniform DirLight dirLight;
 uniform Material material;
 
+const float TileSize = 0.5;
+
 void main()
 {
-    vec3 norm = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - FragPos);
+    // Face normals are exact and not interpolated.
+    vec3 norm = Normal;
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
 
     vec3 lightDir = normalize(-dirLight.direction);
 
@@ -34,8 +44,13 @@ void main()
 
     float ao = 0.5 + 0.5 * dot(norm, vec3(0.0, 1.0, 0.0));
 
-    vec3 ambient = dirLight.ambient * vec3(texture(material.diffuse, TexCoord)) * ao * ambientMultiplier;
-    vec3 diffuse = dirLight.diffuse * diff * vec3(texture(material.diffuse, TexCoord)) * diffuseMultiplier;
+    // TexCoord is in blocks, so wrap it inside the atlas tile. Gradients come
+    // from the unwrapped coordinate to avoid mip seams at the wrap.
+    vec2 tileCoord = TileOrigin + fract(TexCoord) * TileSize;
+    vec3 albedo = vec3(textureGrad(material.diffuse, tileCoord, dFdx(TexCoord) * TileSize, dFdy(TexCoord) * TileSize));
+
+    vec3 ambient = dirLight.ambient * albedo * ao * ambientMultiplier;
+    vec3 diffuse = dirLight.diffuse * diff * albedo * diffuseMultiplier;
 
     FragColor = vec4(ambient + diffuse, 1.0);
 }
@@ -1,21 +1,45 @@
 #version 460 core
 
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
-layout (location = 2) in vec2 aTexCoord;
+// Packed chunk vertex, see ChunkVertex in chunk.hpp.
+layout (location = 0) in uvec2 aVertex;
+// World position of the chunk's corner, one per draw.
+layout (location = 1) in ivec2 aChunkOrigin;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Per-frame camera data, see CameraUniforms in camera.hpp.
+layout (std140, binding = 0) uniform Camera
+{
+    mat4 viewProjection;
+    vec4 viewPos;
+};
 
 out vec3 FragPos;
-out vec3 Normal;
+flat out vec3 Normal;
 out vec2 TexCoord;
+flat out vec2 TileOrigin;
+
+// Indexed by face id: -x, +x, -y, +y, -z, +z.
+const vec3 FaceNormals[6] = vec3[](
+    vec3(-1.0, 0.0, 0.0), vec3(1.0, 0.0, 0.0),
+    vec3(0.0, -1.0, 0.0), vec3(0.0, 1.0, 0.0),
+    vec3(0.0, 0.0, -1.0), vec3(0.0, 0.0, 1.0)
+);
+
+// The atlas is a 2x2 grid of tiles. Indexed by BlockType: air, dirt, rock,
+// sand, snow, water.
+const vec2 TileOrigins[6] = vec2[](
+    vec2(0.0, 0.0), vec2(0.0, 0.5), vec2(0.5, 0.5),
+    vec2(0.5, 0.0), vec2(0.0, 0.0), vec2(0.0, 0.0)
+);
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    TexCoord = aTexCoord;
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    vec3 pos = vec3(aVertex.x & 127u, (aVertex.x >> 7) & 511u, (aVertex.x >> 16) & 127u);
+    uint face = (aVertex.x >> 23) & 7u;
+    uint block = aVertex.x >> 26;
+
+    FragPos = pos + vec3(aChunkOrigin.x, 0.0, aChunkOrigin.y);
+    Normal = FaceNormals[face];
+    TexCoord = vec2(aVertex.y & 511u, (aVertex.y >> 9) & 511u);
+    TileOrigin = TileOrigins[min(block, 5u)];
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
 }
@@ -1,14 +1,20 @@
 #version 460 core
 
 in vec3 FragPos;
-in vec3 Normal;
+flat in vec3 Normal;
 in vec2 TexCoord;
 
 out vec4 FragColor;
 
+// Per-frame camera data, see CameraUniforms in camera.hpp.
+layout (std140, binding = 0) uniform Camera
+{
+    mat4 viewProjection;
+    vec4 viewPos;
+};
+
 uniform vec3 lightColor;
 uniform vec3 lightPos;
-uniform vec3 viewPos;
 uniform sampler2D waterTexture;
 
 void main()
@@ -17,14 +23,14 @@ void main()
     vec3 ambient = ambientStrength * lightColor;
 
     // Diffuse
-    vec3 norm = normalize(Normal);
+    vec3 norm = Normal;
     vec3 lightDir = normalize(lightPos - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
     vec3 diffuse = diff * lightColor;
 
     // Specular
     float specularStrength = 0.5;
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
     vec3 specular = specularStrength * spec * lightColor;
@@ -0,0 +1,34 @@
+#include "allocCounter.hpp"
+
+#include <cstdlib>
+#include <new>
+
+// Only built with the PROCEDURALGEN_COUNT_ALLOCS CMake option.
+#ifdef PROCEDURALGEN_COUNT_ALLOCS
+
+static thread_local size_t t_AllocationCount = 0;
+
+size_t ThreadAllocationCount()
+{
+    return t_AllocationCount;
+}
+
+// The array and nothrow forms forward to these, so they are counted as well.
+void* operator new(size_t size)
+{
+    ++t_AllocationCount;
+    if(void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+
+// Whether allocations are counted. Only builds with the
+// PROCEDURALGEN_COUNT_ALLOCS CMake option compile allocCounter.cpp, which
+// replaces the global allocation functions.
+#ifdef PROCEDURALGEN_COUNT_ALLOCS
+static const bool AllocationCountingEnabled = true;
+
+// Number of heap allocations made through global operator new by the calling
+// thread so far. The count is per thread so measuring one piece of code isn't
+// disturbed by the job workers.
+size_t ThreadAllocationCount();
+#else
+static const bool AllocationCountingEnabled = false;
+
+inline size_t ThreadAllocationCount()
+{
+    return 0;
+}
+#endif
@@ -1,5 +1,6 @@
 #include "app.hpp"
 
+#include <cmath>
 #include <vector>
 
 #include <glad/gl.h>
@@ -37,16 +38,20 @@ void App::Run()
 
     textureAtlas.Bind();
     shader.Bind();
-    shader.SetUniform("material.diffuse", 0);
-    shader.SetUniform("dirLight.direction", glm::vec3(-0.2f, -1.0f, -0.3f));
-    shader.SetUniform("dirLight.ambient", glm::vec3(0.05f, 0.05f, 0.05f));
-    shader.SetUniform("dirLight.diffuse", glm::vec3(0.4f, 0.4f, 0.4f));
+    shader.SetUniform(shader.GetUniform("material.diffuse"), 0);
+    shader.SetUniform(shader.GetUniform("dirLight.direction"), glm::vec3(-0.2f, -1.0f, -0.3f));
+    shader.SetUniform(shader.GetUniform("dirLight.ambient"), glm::vec3(0.05f, 0.05f, 0.05f));
+    shader.SetUniform(shader.GetUniform("dirLight.diffuse"), glm::vec3(0.4f, 0.4f, 0.4f));
 
     waterTexture.Bind(1);
     waterShader.Bind();
-    waterShader.SetUniform("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
-    waterShader.SetUniform("lightPos", lightPos);
-    waterShader.SetUniform("waterTexture", 1);
+    waterShader.SetUniform(waterShader.GetUniform("lightColor"), glm::vec3(1.0f, 1.0f, 1.0f));
+    waterShader.SetUniform(waterShader.GetUniform("lightPos"), lightPos);
+    waterShader.SetUniform(waterShader.GetUniform("waterTexture"), 1);
+
+    // Bound once; every program reads the camera from the same block.
+    BufferHandle cameraUniforms(CreateUniformBuffer(sizeof(CameraUniforms)));
+    BindUniformBuffer(CameraUniformBinding, cameraUniforms.Get());
 
     SetupImgui();
 
@@ -60,6 +65,8 @@ void App::Run()
         m_DeltaTime = currFrame - m_PrevFrame;
         m_PrevFrame = currFrame;
 
+        BeginGLStateFrame();
+
         m_Input.Update();
         m_Window.PollEvents();
         ProcessAppInput();
@@ -73,49 +80,44 @@ void App::Run()
             m_Camera.Update(m_DeltaTime);
         }
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if(m_Flythrough)
+        {
+            const float range = ChunkSize * 4.0f;
+            m_FlythroughTime += m_DeltaTime;
+            m_Camera.Position.x = m_FlythroughOrigin.x + std::sin(m_FlythroughTime * 0.5f) * range;
+        }
 
-        glm::mat4 model(1.0);
-        glm::mat4 view = m_Camera.GetViewMatrix();
-        glm::mat4 proj = m_Camera.GetProjectionMatrix();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        SetPolygonMode(m_Wireframe ? GL_LINE : GL_FILL);
 
-        shader.Bind();
-        shader.SetUniform("view", view);
-        shader.SetUniform("projection", proj);
-        shader.SetUniform("viewPos", m_Camera.Position);
+        const CameraUniforms camera = m_Camera.GetUniforms();
+        UpdateUniformBuffer(cameraUniforms.Get(), &camera, sizeof(camera));
 
         m_World.UpdateActiveChunks(m_Camera.Position);
-        std::vector<const Chunk*> chunks = m_World.GetActiveChunks(m_Camera.Position);
+        m_World.CullChunks(m_Camera.GetFrustum());
 
-        textureAtlas.Bind();
-        for(auto chunk : chunks)
-        {
-            glm::mat4 model(1.0f);
-            model = glm::translate(model, glm::vec3(chunk->X * ChunkSize, 0, chunk->Y * ChunkSize));
-            shader.SetUniform("model", model);
+        ChunkRenderer& chunkRenderer = m_World.GetChunkRenderer();
 
-            chunk->Render();
-        }
+        shader.Bind();
+        textureAtlas.Bind();
+        chunkRenderer.Draw(m_World.GetVisibleChunks(), ChunkPass::TERRAIN);
 
         waterShader.Bind();
-        waterShader.SetUniform("view", view);
-        waterShader.SetUniform("projection", proj);
-        waterShader.SetUniform("viewPos", m_Camera.Position);
         waterTexture.Bind(1);
 
-        for(auto chunk : chunks)
-        {
-            glm::mat4 model(1.0f);
-            model = glm::translate(model, glm::vec3(chunk->X * ChunkSize, 0, chunk->Y * ChunkSize));
-            waterShader.SetUniform("model", model);
-            chunk->RenderWater();
-        }
+        chunkRenderer.Draw(m_World.GetVisibleWaterChunks(), ChunkPass::WATER);
+        chunkRenderer.EndFrame();
 
         // DrawImGui Stuff
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        if(m_GuiActive)
+        {
+            DrawWorldGui();
+        }
+
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
@@ -132,16 +134,7 @@ void App::ProcessAppInput()
 
     if(m_Input.KeyJustPressed(Key::COMMA))
     {
-        static bool isWireframe = false;
-        if(isWireframe)
-        {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        }
-        else
-        {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        }
-        isWireframe = !isWireframe;
+        m_Wireframe = !m_Wireframe;
     }
 
     if(m_Input.KeyJustPressed(Key::INSERT))
@@ -177,3 +170,232 @@ void App::SetupImgui()
     ImGui_ImplGlfw_InitForOpenGL(m_Window.GetGLFWWindow(), true);
     ImGui_ImplOpenGL3_Init();
 }
+
+void App::DrawWorldGui()
+{
+    ImGui::Begin("World");
+
+    ImGui::Text("Workers: %u", m_World.WorkerCount());
+    ImGui::Text("Pending chunks: %zu", m_World.PendingChunks());
+    const ChunkPool& pool = m_World.GetChunkPool();
+    ImGui::Text("Chunk pool: %zu allocated, %zu recycled, %zu free", pool.AllocatedCount(), pool.RecycledCount(), pool.FreeCount());
+    ImGui::Text("Block storage: %zu bytes/chunk (dense %zu)", m_World.AverageBlockBytes(), Chunk::DenseBlockBytes);
+    ImGui::Text("Uniform sections: %.1f/%d per chunk", m_World.AverageUniformSections(), SectionCount);
+
+    const ChunkCache& cache = m_World.GetChunkCache();
+    const ChunkCacheStats& cacheStats = cache.Stats();
+    if(ImGui::SliderInt("Chunk cache (MB)", &m_CacheMegabytes, 0, 512))
+    {
+        m_World.SetChunkCacheBytes((size_t)m_CacheMegabytes << 20);
+    }
+    if(ImGui::Checkbox("Cache meshes", &m_CacheMeshes))
+    {
+        m_World.SetCacheChunkMeshes(m_CacheMeshes);
+    }
+    ImGui::Text("Cache: %zu chunks, %.1f MB", cache.Count(), cache.UsedBytes() / (1024.0f * 1024.0f));
+    ImGui::Text("Cache hit rate: %.1f%% (%zu hits, %zu misses, %zu evicted)", cacheStats.HitRate() * 100.0f,
+                cacheStats.Hits, cacheStats.Misses, cacheStats.Evictions);
+    ImGui::Text("Saved: %zu chunk generations, %zu meshes", cacheStats.Hits, cacheStats.MeshesReused);
+    const HeightmapCache& heightmaps = m_World.GetNoiseGen().GetHeightmapCache();
+    const HeightmapCacheStats heightmapStats = heightmaps.Stats();
+    ImGui::Text("Heightmap tiles: %zu/%zu, hit rate %.1f%% (%zu evicted, %zu invalidations)", heightmaps.Count(),
+                heightmaps.CapacityTiles(), heightmapStats.HitRate() * 100.0f, heightmapStats.Evictions, heightmapStats.Invalidations);
+    if(ImGui::Checkbox("Back-and-forth flythrough", &m_Flythrough) && m_Flythrough)
+    {
+        m_FlythroughOrigin = m_Camera.Position;
+        m_FlythroughTime = 0.0f;
+        m_World.ResetChunkCacheStats();
+        m_World.GetNoiseGen().ResetHeightmapCacheStats();
+    }
+
+    int storage = (int)m_World.GetChunkStorage();
+    const char* storages[ChunkStorageCount];
+    for(int i = 0; i < ChunkStorageCount; ++i)
+    {
+        storages[i] = ChunkStorageName((ChunkStorage)i);
+    }
+    if(ImGui::Combo("Chunk storage", &storage, storages, ChunkStorageCount))
+    {
+        m_World.SetChunkStorage((ChunkStorage)storage);
+    }
+
+    int mode = (int)m_World.GetMeshMode();
+    const char* modes[MeshModeCount];
+    for(int i = 0; i < MeshModeCount; ++i)
+    {
+        modes[i] = MeshModeName((MeshMode)i);
+    }
+    if(ImGui::Combo("Mesher", &mode, modes, MeshModeCount))
+    {
+        m_World.SetMeshMode((MeshMode)mode);
+    }
+
+    if(ImGui::Button("Compare meshers on current chunk"))
+    {
+        m_HasMeshComparison = m_World.CompareMeshModes(m_Camera.Position, m_MeshStats, 20);
+    }
+
+    if(m_HasMeshComparison)
+    {
+        const MeshStats& baseline = m_MeshStats[(int)MeshMode::NAIVE];
+        for(int i = 0; i < MeshModeCount; ++i)
+        {
+            const MeshStats& stats = m_MeshStats[i];
+            ImGui::Text("%-7s %7zu verts, %7zu indices, %.3f ms (%.1fx)", modes[i], stats.Vertices, stats.Indices,
+                        stats.TimeMs, stats.TimeMs > 0.0f ? baseline.TimeMs / stats.TimeMs : 0.0f);
+            ImGui::Text("        %7.1f KB packed, %7.1f KB as floats (%.1fx smaller)", stats.Bytes / 1024.0f,
+                        stats.UnpackedBytes / 1024.0f, stats.Bytes ? (float)stats.UnpackedBytes / stats.Bytes : 0.0f);
+            if(stats.CountsAllocations)
+                ImGui::Text("        %5.1f allocs/mesh, %5.1f reusing the mesh (%.3f ms)", stats.Allocations,
+                            stats.ReusedAllocations, stats.ReusedTimeMs);
+            else
+                ImGui::Text("        allocs not counted, %.3f ms reusing the mesh", stats.ReusedTimeMs);
+        }
+    }
+
+    if(ImGui::Button("Benchmark heightmap generation"))
+    {
+        m_HeightmapStats = MeasureHeightmaps(m_World.GetNoiseGen(), 2 * ActiveRadius + 1, TerrainFeatureSize, 20);
+        m_HasHeightmapStats = true;
+    }
+    if(m_HasHeightmapStats)
+    {
+        ImGui::Text("Heightmaps: %.1f Mcells/s per chunk, %.1f Mcells/s per strip (%.2fx)",
+                    m_HeightmapStats.PerChunkCellsPerSec / 1e6, m_HeightmapStats.BatchedCellsPerSec / 1e6,
+                    m_HeightmapStats.PerChunkCellsPerSec > 0.0 ? m_HeightmapStats.BatchedCellsPerSec / m_HeightmapStats.PerChunkCellsPerSec : 0.0);
+    }
+
+    if(ImGui::Button("Benchmark terrain fill"))
+    {
+        m_TerrainFillStats = MeasureTerrainFill(m_World.GetNoiseGen(), TerrainFeatureSize, 64);
+        m_HasTerrainFillStats = true;
+    }
+    if(m_HasTerrainFillStats)
+    {
+        ImGui::Text("Noise: %.3f ms per chunk", m_TerrainFillStats.NoiseMsPerChunk);
+        for(int level = 0; level <= (int)SupportedSimdLevel(); ++level)
+        {
+            const double fill = m_TerrainFillStats.FillMsPerChunk[level];
+            ImGui::Text("Fill (%s): %.3f ms per chunk, %.0f%% of noise", SimdLevelName((SimdLevel)level), fill,
+                        m_TerrainFillStats.NoiseMsPerChunk > 0.0 ? 100.0 * fill / m_TerrainFillStats.NoiseMsPerChunk : 0.0);
+        }
+    }
+
+    if(ImGui::Button("Benchmark block layouts"))
+    {
+        m_BlockLayoutBenchmark = MeasureBlockLayouts(m_World.GetNoiseGen(), TerrainFeatureSize, 32);
+        m_HasBlockLayoutStats = true;
+    }
+    if(m_HasBlockLayoutStats)
+    {
+        ImGui::Text("Per chunk: fill / binary mesh / GetBlock sweep (ms)%s",
+                    m_BlockLayoutBenchmark.CountsMisses ? ", L1D read misses" : "; no cache counters");
+        for(int layout = 0; layout < BlockLayoutCount; ++layout)
+        {
+            const BlockLayoutStats& stats = m_BlockLayoutBenchmark.Layouts[layout];
+            ImGui::Text("%-9s %6.3f / %6.3f / %6.3f ms, %zu bytes%s", BlockLayoutName((BlockLayout)layout),
+                        stats.FillMs, stats.MeshMs, stats.QueryMs, stats.BlockBytes, layout == (int)DefaultBlockLayout::Id ? " (in use)" : "");
+            if(m_BlockLayoutBenchmark.CountsMisses)
+                ImGui::Text("          %6.0f / %6.0f / %6.0f misses", stats.FillMisses, stats.MeshMisses, stats.QueryMisses);
+        }
+    }
+
+    if(ImGui::Button("Benchmark chunk shapes"))
+    {
+        m_ChunkShapeStats = MeasureChunkShapes(m_World.GetNoiseGen(), TerrainFeatureSize, 5);
+        m_HasChunkShapeStats = true;
+    }
+    if(m_HasChunkShapeStats)
+    {
+        ImGui::Text("%dx%d columns: noise / fill / borders / binary mesh (ms)", ChunkShapeBenchmarkArea, ChunkShapeBenchmarkArea);
+        for(int shape = 0; shape < ChunkShapeCount; ++shape)
+        {
+            const ChunkShapeStats& stats = m_ChunkShapeStats[shape];
+            ImGui::Text("%-9s %6.2f / %6.2f / %6.2f / %6.2f ms, %3d chunks%s", ChunkShapeName((ChunkShape)shape), stats.NoiseMs,
+                        stats.FillMs, stats.BorderMs, stats.MeshMs, stats.Chunks,
+                        stats.Size == ChunkSize && stats.Height == ChunkHeight ? " (in use)" : "");
+            ImGui::Text("          %6.2f Mcolumns/s, %7.1f Mblocks/s, %zu verts", stats.ColumnsPerSec() / 1e6,
+                        stats.BlocksPerSec() / 1e6, stats.Vertices);
+        }
+    }
+
+    bool frustumCulling = m_World.GetFrustumCulling();
+    if(ImGui::Checkbox("Frustum culling", &frustumCulling))
+    {
+        m_World.SetFrustumCulling(frustumCulling);
+    }
+    ImGui::Text("Culled chunks: %zu/%zu (%zu water passes drawn), %.3f ms", m_World.CulledChunks(),
+                m_World.GetActiveChunks().size(), m_World.GetVisibleWaterChunks().size(), m_World.CullTimeMs());
+
+    ImGui::Text("Triangles drawn: %zu", m_World.DrawnTriangles());
+    ChunkRenderer& chunkRenderer = m_World.GetChunkRenderer();
+    const QuadIndexBuffer& quadIndices = chunkRenderer.QuadIndices();
+    ImGui::Text("Shared quad indices: %zu quads, %.1f KB", quadIndices.Quads(), quadIndices.MemoryUsage() / 1024.0f);
+    const MeshArena& arena = chunkRenderer.Arena();
+    ImGui::Text("Mesh arena: %.1f/%.1f MB used, %.1f MB retired, %zu free ranges", (float)arena.Used() * arena.ElementSize() / (1 << 20),
+                (float)arena.Capacity() * arena.ElementSize() / (1 << 20), (float)arena.Retired() * arena.ElementSize() / (1 << 20),
+                arena.FreeRanges());
+    const GLResourceStats& resources = chunkRenderer.ResourceStats();
+    ImGui::Text("GL buffers: %zu live, %.1f MB (%zu free, %zu awaiting fence)", resources.LiveBuffers,
+                resources.LiveBytes / (1024.0f * 1024.0f), resources.FreeBuffers, resources.PendingBuffers);
+    ImGui::Text("GL buffers: %zu created, %zu recycled, %zu deleted", resources.Created, resources.Recycled, resources.Deleted);
+    ImGui::Text("Indirect commands: %zu terrain, %zu water, one multi-draw per pass", chunkRenderer.DrawCommands(ChunkPass::TERRAIN),
+                chunkRenderer.DrawCommands(ChunkPass::WATER));
+    if(ImGui::SliderInt("Upload budget (KB/frame)", &m_UploadBudgetKilobytes, 64, 16384))
+    {
+        m_World.SetUploadBudget((size_t)m_UploadBudgetKilobytes << 10);
+    }
+    const ChunkRenderer::UploadStats& uploads = chunkRenderer.GetUploadStats();
+    const StagingRing& staging = chunkRenderer.Staging();
+    ImGui::Text("Uploads: %zu chunks, %.1f KB this frame, %zu queued", uploads.Chunks, uploads.Bytes / 1024.0f,
+                m_World.PendingUploads());
+    ImGui::Text("Staging ring: %.1f/%.1f MB in flight, %zu fences, %zu stalls, %zu direct", staging.Used() / (1024.0f * 1024.0f),
+                staging.Capacity() / (1024.0f * 1024.0f), staging.PendingFences(), uploads.Stalls, uploads.Direct);
+    const GLStateStats& glState = LastFrameGLStateStats();
+    size_t issued = 0;
+    size_t skipped = 0;
+    for(int i = 0; i < GLStateCallCount; ++i)
+    {
+        issued += glState.Issued[i];
+        skipped += glState.Skipped[i];
+    }
+    if(ImGui::TreeNode("GL state calls", "GL state calls: %zu issued, %zu skipped last frame", issued, skipped))
+    {
+        for(int i = 0; i < GLStateCallCount; ++i)
+        {
+            ImGui::Text("%-13s %4zu issued, %4zu skipped", GLStateCallName((GLStateCall)i), glState.Issued[i], glState.Skipped[i]);
+        }
+        ImGui::TreePop();
+    }
+    if(ImGui::Button("Measure cross-chunk culling"))
+    {
+        m_World.MeasureBorderCulling(m_TrianglesWithBorders, m_TrianglesWithoutBorders);
+        m_HasBorderCullingStats = true;
+    }
+    if(m_HasBorderCullingStats && m_TrianglesWithoutBorders > 0)
+    {
+        ImGui::Text("%zu triangles with neighbor culling, %zu without (-%.1f%%)", m_TrianglesWithBorders, m_TrianglesWithoutBorders,
+                    100.0f * (1.0f - (float)m_TrianglesWithBorders / m_TrianglesWithoutBorders));
+    }
+
+    if(ImGui::Button("Benchmark chunk map"))
+    {
+        for(size_t i = 0; i < ChunkMapBenchmarkRadii.size(); ++i)
+        {
+            m_ChunkMapStats[i] = MeasureChunkMap(ChunkMapBenchmarkRadii[i]);
+        }
+        m_HasChunkMapStats = true;
+    }
+
+    if(m_HasChunkMapStats)
+    {
+        ImGui::Text("Mops/s        lookup (old)   insert+erase (old)");
+        for(const ChunkMapStats& stats : m_ChunkMapStats)
+        {
+            ImGui::Text("radius %2d  %6.1f (%6.1f)   %6.1f (%6.1f)", stats.Radius, stats.LookupRate, stats.BaselineLookupRate,
+                        stats.UpdateRate, stats.BaselineUpdateRate);
+        }
+    }
+
+    ImGui::End();
+}
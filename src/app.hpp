@@ -3,6 +3,8 @@
 #include <GLFW/glfw3.h>
 
 #include "inputManager.hpp"
+#include "chunkShape.hpp"
+#include "layoutBenchmark.hpp"
 #include "window.hpp"
 #include "camera.hpp"
 #include "texture.hpp"
@@ -21,6 +23,7 @@ private:
 	void ProcessAppInput();
 
 	void SetupImgui();
+	void DrawWorldGui();
 
 private:
 	Window m_Window;
@@ -33,6 +36,37 @@ private:
 	float m_PrevFrame;
 
 	bool m_GuiActive = false;
+	bool m_Wireframe = false;
+
+	bool m_HasMeshComparison = false;
+	std::array<MeshStats, MeshModeCount> m_MeshStats;
+	bool m_HasChunkMapStats = false;
+	std::array<ChunkMapStats, ChunkMapBenchmarkRadii.size()> m_ChunkMapStats;
+
+	bool m_HasHeightmapStats = false;
+	HeightmapStats m_HeightmapStats;
+
+	bool m_HasTerrainFillStats = false;
+	TerrainFillStats m_TerrainFillStats;
+
+	bool m_HasBlockLayoutStats = false;
+	BlockLayoutBenchmark m_BlockLayoutBenchmark;
+
+	bool m_HasChunkShapeStats = false;
+	std::array<ChunkShapeStats, ChunkShapeCount> m_ChunkShapeStats;
+
+	bool m_HasBorderCullingStats = false;
+	size_t m_TrianglesWithBorders = 0;
+	size_t m_TrianglesWithoutBorders = 0;
+
+	int m_CacheMegabytes = (int)(World::DefaultCacheBytes >> 20);
+	int m_UploadBudgetKilobytes = (int)(World::DefaultUploadBudgetBytes >> 10);
+	bool m_CacheMeshes = true;
+
+	// Sweeps the camera back and forth along x to exercise chunk streaming.
+	bool m_Flythrough = false;
+	float m_FlythroughTime = 0.0f;
+	glm::vec3 m_FlythroughOrigin;
 
 	World m_World;
 };
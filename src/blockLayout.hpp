@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "paletteStorage.hpp"
+
+
+// Order a chunk section stores its blocks in. Picked at compile time: each
+// layout is a policy type giving a block's index and the bulk reads the
+// mesher and border extraction use, written for the runs that layout keeps
+// contiguous. The terrain fill packs each layout in its own way too.
+enum class BlockLayout : uint8_t
+{
+    Z_ROWS = 0,
+    Y_COLUMNS,
+    MORTON,
+};
+static const int BlockLayoutCount = 3;
+
+inline const char* BlockLayoutName(BlockLayout layout)
+{
+    switch(layout)
+    {
+        case BlockLayout::Z_ROWS: return "Z rows";
+        case BlockLayout::Y_COLUMNS: return "Y columns";
+        case BlockLayout::MORTON: return "Morton";
+        default: return "Unknown";
+    }
+}
+
+// Every layout below is for a Size x Height x Size section and offers:
+//   Index(x, y, z)
+//   ZRow(blocks, x, y, value): bit z set when block (x, y, z) is value.
+//   MatchRows(blocks, layers, value, rows): rows[y * Size + x] = ZRow(x, y)
+//     for every x and every y < layers.
+
+// [x][y][z]. Rows along z are contiguous, so they are matched packed.
+template<int Size, int Height>
+struct ZRowLayout
+{
+    static constexpr BlockLayout Id = BlockLayout::Z_ROWS;
+
+    static size_t Index(int x, int y, int z) { return ((size_t)x * Height + y) * Size + z; }
+
+    template<typename T>
+    static uint64_t ZRow(const PaletteStorage<T>& blocks, int x, int y, T value)
+    {
+        return blocks.MatchMask(Index(x, y, 0), Size, value);
+    }
+
+    template<typename T>
+    static void MatchRows(const PaletteStorage<T>& blocks, int layers, T value, uint64_t* rows)
+    {
+        for(int x = 0; x < Size; ++x)
+        {
+            for(int y = 0; y < layers; ++y)
+                rows[y * Size + x] = ZRow(blocks, x, y, value);
+        }
+    }
+};
+
+// [x][z][y]. Each column is contiguous: the terrain fill writes a whole
+// column as one template, and columns are matched packed, then transposed
+// into rows bit by bit.
+template<int Size, int Height>
+struct YColumnLayout
+{
+    static constexpr BlockLayout Id = BlockLayout::Y_COLUMNS;
+
+    static size_t Index(int x, int y, int z) { return ((size_t)x * Size + z) * Height + y; }
+
+    template<typename T>
+    static uint64_t ZRow(const PaletteStorage<T>& blocks, int x, int y, T value)
+    {
+        uint64_t row = 0;
+        for(int z = 0; z < Size; ++z)
+            row |= (uint64_t)(blocks.Get(Index(x, y, z)) == value) << z;
+        return row;
+    }
+
+    template<typename T>
+    static void MatchRows(const PaletteStorage<T>& blocks, int layers, T value, uint64_t* rows)
+    {
+        std::fill(rows, rows + (size_t)layers * Size, 0);
+        for(int x = 0; x < Size; ++x)
+        {
+            for(int z = 0; z < Size; ++z)
+            {
+                uint64_t column = blocks.MatchMask(Index(x, 0, z), layers, value);
+                while(column)
+                {
+                    const int y = std::countr_zero(column);
+                    rows[y * Size + x] |= 1ull << z;
+                    column &= column - 1;
+                }
+            }
+        }
+    }
+};
+
+// Axis (0 x, 1 y, 2 z) and coordinate bit every index bit of a Morton index
+// comes from. Bits are dealt z, x, y from the lowest up, skipping an axis
+// once its bits run out, so z pairs share a byte and any 2x2x2 cube is
+// contiguous.
+template<int Size, int Height>
+struct MortonTables
+{
+    static constexpr int AxisBits[3] = { std::countr_zero((unsigned int)Size), std::countr_zero((unsigned int)Height),
+                                         std::countr_zero((unsigned int)Size) };
+    static constexpr int IndexBits = AxisBits[0] + AxisBits[1] + AxisBits[2];
+    static constexpr int MaxDim = Size > Height ? Size : Height;
+
+    std::array<uint8_t, IndexBits> Axis{};
+    std::array<uint8_t, IndexBits> Bit{};
+    // Index bits of each coordinate, per axis.
+    std::array<std::array<uint32_t, MaxDim>, 3> Spread{};
+    // Coordinates of the 64 indices a packed match mask covers, relative to
+    // the first: index bits never overlap, so they just add.
+    std::array<std::array<uint8_t, 3>, 64> LowCoords{};
+
+    constexpr MortonTables()
+    {
+        int next[3] = {};
+        const int order[3] = { 2, 0, 1 };
+        for(int bit = 0; bit < IndexBits;)
+        {
+            for(int axis : order)
+            {
+                if(next[axis] == AxisBits[axis] || bit == IndexBits)
+                    continue;
+                Axis[bit] = (uint8_t)axis;
+                Bit[bit] = (uint8_t)next[axis]++;
+                ++bit;
+            }
+        }
+
+        const int dims[3] = { Size, Height, Size };
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            for(int v = 0; v < dims[axis]; ++v)
+            {
+                for(int bit = 0; bit < IndexBits; ++bit)
+                {
+                    if(Axis[bit] == axis && (v >> Bit[bit]) & 1)
+                        Spread[axis][v] |= 1u << bit;
+                }
+            }
+        }
+
+        for(int index = 0; index < 64; ++index)
+        {
+            for(int bit = 0; bit < 6; ++bit)
+                LowCoords[index][Axis[bit]] |= (uint8_t)(((index >> bit) & 1) << Bit[bit]);
+        }
+    }
+
+    // Coordinates of index, as x, y, z.
+    constexpr std::array<int, 3> Coords(size_t index) const
+    {
+        std::array<int, 3> coords{};
+        for(int bit = 0; bit < IndexBits; ++bit)
+            coords[Axis[bit]] |= (int)((index >> bit) & 1) << Bit[bit];
+        return coords;
+    }
+};
+
+// 3D Z-order: the bits of x, y and z interleaved. Neighbors along every axis
+// are usually a few indices apart instead of a row or a plane. Matching
+// walks the storage in order, 64 packed blocks at a time, and scatters the
+// matches into rows.
+template<int Size, int Height>
+struct MortonLayout
+{
+    static_assert(std::has_single_bit((unsigned int)Size) && std::has_single_bit((unsigned int)Height),
+                  "Morton order needs power of two dimensions");
+    static_assert(Size >= 4 && Height >= 4, "Matching works on whole words of 64 blocks");
+
+    static constexpr BlockLayout Id = BlockLayout::MORTON;
+    static constexpr MortonTables<Size, Height> Tables{};
+    static constexpr size_t Count = (size_t)Size * Height * Size;
+
+    static size_t Index(int x, int y, int z) { return Tables.Spread[0][x] | Tables.Spread[1][y] | Tables.Spread[2][z]; }
+
+    template<typename T>
+    static uint64_t ZRow(const PaletteStorage<T>& blocks, int x, int y, T value)
+    {
+        const size_t base = Tables.Spread[0][x] | Tables.Spread[1][y];
+        uint64_t row = 0;
+        for(int z = 0; z < Size; ++z)
+            row |= (uint64_t)(blocks.Get(base | Tables.Spread[2][z]) == value) << z;
+        return row;
+    }
+
+    template<typename T>
+    static void MatchRows(const PaletteStorage<T>& blocks, int layers, T value, uint64_t* rows)
+    {
+        std::fill(rows, rows + (size_t)layers * Size, 0);
+        for(size_t start = 0; start < Count; start += 64)
+        {
+            uint64_t match = blocks.MatchMask(start, 64, value);
+            if(!match)
+                continue;
+
+            const std::array<int, 3> base = Tables.Coords(start);
+            while(match)
+            {
+                const std::array<uint8_t, 3>& low = Tables.LowCoords[std::countr_zero(match)];
+                const int y = base[1] + low[1];
+                if(y < layers)
+                    rows[y * Size + base[0] + low[0]] |= 1ull << (base[2] + low[2]);
+                match &= match - 1;
+            }
+        }
+    }
+};
+
+// Runs fn with a default constructed policy of the given layout, so code
+// templated on the layout can be picked at runtime.
+template<int Size, int Height, typename Fn>
+decltype(auto) VisitBlockLayout(BlockLayout layout, Fn&& fn)
+{
+    switch(layout)
+    {
+        case BlockLayout::Y_COLUMNS: return fn(YColumnLayout<Size, Height>{});
+        case BlockLayout::MORTON: return fn(MortonLayout<Size, Height>{});
+        default: return fn(ZRowLayout<Size, Height>{});
+    }
+}
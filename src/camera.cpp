@@ -15,6 +15,19 @@ glm::mat4 Camera::GetProjectionMatrix()
     return glm::perspective(glm::radians(m_Fov), m_AspectRatio, m_NearClip, m_FarClip);
 }
 
+Frustum Camera::GetFrustum()
+{
+    return Frustum::FromMatrix(GetProjectionMatrix() * GetViewMatrix());
+}
+
+CameraUniforms Camera::GetUniforms()
+{
+    CameraUniforms uniforms;
+    uniforms.ViewProjection = GetProjectionMatrix() * GetViewMatrix();
+    uniforms.ViewPos = glm::vec4(Position, 1.0f);
+    return uniforms;
+}
+
 glm::mat4 Camera::GetViewMatrix()
 {
 	glm::vec3 forward = Orientation * glm::vec3(0.0f, 0.0f, -1.0f);
@@ -3,9 +3,22 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include "frustum.hpp"
 #include "inputManager.hpp"
 
 
+// Per-frame camera data, shared by every program through the std140 uniform
+// block "Camera" at CameraUniformBinding. Members are vec4 aligned, so the
+// position is padded to a vec4.
+struct CameraUniforms
+{
+    glm::mat4 ViewProjection;
+    glm::vec4 ViewPos;
+};
+static_assert(sizeof(CameraUniforms) == 80, "CameraUniforms must match the std140 layout");
+
+static constexpr unsigned int CameraUniformBinding = 0;
+
 class Camera
 {
 public:
@@ -18,6 +31,8 @@ public:
     void LockOrientation() { m_LastMousePos = m_Input->GetMousePos(); }
     glm::mat4 GetViewMatrix();
     glm::mat4 GetProjectionMatrix();
+    Frustum GetFrustum();
+    CameraUniforms GetUniforms();
 
     void SetSensitivity(float sens) { m_Sensitivity = (sens > 0) ? sens : 0.1f; }
     void SetMoveSpeed(float speed) { m_MoveSpeed = (speed > 0) ? speed : 1.0f; }
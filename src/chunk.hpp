@@ -1 +1,339 @@
+#pragma once
 
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "blockLayout.hpp"
+#include "graphics.hpp"
+#include "meshArena.hpp"
+#include "paletteStorage.hpp"
+
+
+// Shape of the world's chunks. Chunk code is templated on the dimensions, so
+// other shapes can be built side by side; see chunkShape.hpp.
+static const int ChunkSize = 32;
+static const int ChunkHeight = 100;
+// Chunks are split vertically into sections of this many layers.
+static const int SectionHeight = 16;
+
+constexpr int SectionCountFor(int height)
+{
+    return (height + SectionHeight - 1) / SectionHeight;
+}
+
+static const int SectionCount = SectionCountFor(ChunkHeight);
+static const int ActiveRadius = 5;
+// Loaded chunks are only unloaded once they are this far from the camera
+// chunk, so moving back and forth over a chunk border doesn't thrash.
+static const int UnloadRadius = ActiveRadius + 2;
+
+ enum class BlockType : uint8_t { AIR = 0, DIRT,
+    ROCK,
+    SAND,
+    SNOW,
+    WATER
+};
+
+// Only touched by the main thread. A chunk is GENERATING from the moment its
+// job is submitted until the main thread has uploaded its mesh.
+enum class ChunkState : uint8_t
+{
+    GENERATING = 0,
+    READY,
+    // A ready chunk whose mesh is being rebuilt on a worker. Its blocks and GL
+    // objects stay valid and it keeps being drawn until the new mesh is in.
+    REMESHING,
+};
+
+// Horizontal sides of a chunk. Chunk Y runs along world z.
+enum class ChunkSide : uint8_t
+{
+    NEG_X = 0,
+    POS_X,
+    NEG_Z,
+    POS_Z,
+};
+static const int ChunkSideCount = 4;
+
+inline ChunkSide OppositeSide(ChunkSide side)
+{
+    return (ChunkSide)((int)side ^ 1);
+}
+
+// Offset to the chunk across the given side.
+inline void SideOffset(ChunkSide side, int& dx, int& dy)
+{
+    dx = side == ChunkSide::NEG_X ? -1 : side == ChunkSide::POS_X ? 1 : 0;
+    dy = side == ChunkSide::NEG_Z ? -1 : side == ChunkSide::POS_Z ? 1 : 0;
+}
+
+// Copy of the edge layer of the neighboring chunk across one side. Bit i of a
+// row is block i along the edge: z for the x sides, x for the z sides. Lets
+// the mesher cull faces on chunk borders without touching the neighbor,
+// which may be unloaded or recycled while a mesh job runs.
+template<int Height>
+struct BasicChunkBorder
+{
+    bool Present = false;
+    // Any non-air block, which hides solid faces.
+    std::array<uint64_t, Height> Solid;
+    // Water, the only thing that hides water faces.
+    std::array<uint64_t, Height> Water;
+};
+
+// Packed vertex, two words, decoded in terrain.vert and water.vert.
+// Position word: x bits 0-6, y bits 7-15, z bits 16-22, face id bits 23-25,
+// block type bits 26-31. TexCoord word: u bits 0-8, v bits 9-17, in block
+// units so merged quads repeat their tile instead of stretching it. Face ids
+// are 2 * axis + positive, so the shader looks the normal up from a table.
+struct ChunkVertex
+{
+    uint32_t Position;
+    uint32_t TexCoord;
+};
+static_assert(sizeof(ChunkVertex) == 8, "ChunkVertex must stay two words");
+
+inline ChunkVertex PackVertex(int x, int y, int z, int face, BlockType type, int u, int v)
+{
+    return {
+        (uint32_t)x | ((uint32_t)y << 7) | ((uint32_t)z << 16) | ((uint32_t)face << 23) | ((uint32_t)type << 26),
+        (uint32_t)u | ((uint32_t)v << 9)
+    };
+}
+
+// Layout of the float vertices used before ChunkVertex, kept to report how
+// much the packed format saves.
+static const int UnpackedVertexBytes = sizeof(float) * 10;
+
+// Chunk meshes are lists of quads with four consecutive vertices each, so
+// they carry no indices; every chunk is drawn through one shared
+// QuadIndexBuffer instead.
+struct ChunkMesh
+{
+    std::vector<ChunkVertex> Vertices;
+    std::vector<ChunkVertex> WaterVertices;
+
+    void Clear()
+    {
+        Vertices.clear();
+        WaterVertices.clear();
+    }
+
+    size_t VertexCount() const { return Vertices.size() + WaterVertices.size(); }
+    size_t QuadCount() const { return VertexCount() / 4; }
+    // Indices the quads are drawn with, as if they were stored.
+    size_t IndexCount() const { return QuadCount() * 6; }
+
+    size_t MemoryUsage() const { return VertexCount() * sizeof(ChunkVertex); }
+};
+
+// A Size x SectionHeight x Size slice of a chunk. A section holding a single
+// block type keeps no index data at all, and the mesher skips such sections
+// unless a neighbor can expose one of their faces.
+template<int SizeV, typename LayoutT>
+struct BasicChunkSection
+{
+    using Layout = LayoutT;
+    static constexpr int Size = SizeV;
+
+    // Palette-compressed, in the order Layout gives.
+    PaletteStorage<BlockType> Blocks;
+
+    BasicChunkSection() : Blocks(BlockCount, BlockType::AIR)
+    {}
+
+    static constexpr size_t BlockCount = (size_t)Size * SectionHeight * Size;
+
+    static size_t BlockIndex(int x, int localY, int z) { return Layout::Index(x, localY, z); }
+
+    bool Uniform() const { return Blocks.Uniform(); }
+    bool Empty() const { return Uniform() && Blocks.Palette()[0] == BlockType::AIR; }
+    // Only meaningful for uniform sections.
+    BlockType UniformType() const { return Blocks.Palette()[0]; }
+
+    void Fill(BlockType type) { Blocks.Fill(type); }
+
+    // Bit z set when block (x, localY, z) is type.
+    uint64_t ZRow(int x, int localY, BlockType type) const { return Layout::ZRow(Blocks, x, localY, type); }
+
+    // rows[localY * Size + x] = ZRow(x, localY, type) for the first
+    // layers layers.
+    void MatchRows(int layers, BlockType type, uint64_t* rows) const { Layout::MatchRows(Blocks, layers, type, rows); }
+};
+
+// A Size x Height x Size column of blocks. Every loop bound, stride and row
+// mask derived from the dimensions is a compile-time constant.
+template<int SizeV, int HeightV, typename LayoutT = ZRowLayout<SizeV, SectionHeight>>
+struct BasicChunk
+{
+    static constexpr int Size = SizeV;
+    static constexpr int Height = HeightV;
+    static constexpr int SectionCount = SectionCountFor(Height);
+    // Every block of a row along z or x.
+    static constexpr uint64_t FullRow = Size == 64 ? ~0ull : (1ull << Size) - 1;
+
+    static_assert(Size <= 64, "Rows of blocks are packed into one 64-bit word");
+    static_assert(Size < 128 && Height < 512, "Chunk coordinates must fit the packed vertex");
+
+    using Layout = LayoutT;
+    using Section = BasicChunkSection<Size, Layout>;
+    using Border = BasicChunkBorder<Height>;
+
+    int32_t X;
+    int32_t Y;
+    ChunkState State = ChunkState::GENERATING;
+    // Set when the chunk leaves the active range while its job is still
+    // running. The main thread frees it once the job hands it back.
+    bool Cancelled = false;
+    // A neighbor loaded while a job for this chunk was in flight; remesh once
+    // it is done.
+    bool RemeshPending = false;
+
+    // Block y ranges found while generating, used as culling bounds. Terrain
+    // fills [0, TerrainTop), water [WaterBottom, WaterTop). Until then they
+    // cover the whole chunk.
+    int TerrainTop = Height;
+    int WaterBottom = 0;
+    int WaterTop = Height;
+
+    // Bottom to top; section i holds layers [i * SectionHeight, (i + 1) * SectionHeight).
+    std::array<Section, SectionCount> Sections;
+    // Edge layers of the neighbors, indexed by ChunkSide. Written by the main
+    // thread before a mesh job is submitted.
+    std::array<Border, ChunkSideCount> Borders;
+
+    ChunkMesh Mesh;
+    // Where the uploaded mesh lives in the ChunkRenderer's arena. Mesh may be
+    // rebuilt by a worker while these are being drawn.
+    MeshAllocation TerrainMesh;
+    MeshAllocation WaterMesh;
+
+    BasicChunk() : X(0), Y(0)
+    {}
+
+    BasicChunk(int32_t x, int32_t y)
+        : X(x), Y(y)
+    {}
+
+    // Chunks own GL objects and a lot of block data; they are moved, never copied.
+    BasicChunk(const BasicChunk&) = delete;
+    BasicChunk& operator=(const BasicChunk&) = delete;
+    BasicChunk(BasicChunk&&) = default;
+    BasicChunk& operator=(BasicChunk&&) = default;
+
+    // Prepares a recycled chunk for new coordinates. Block storage and mesh
+    // vectors keep their capacity; GL objects are released. Main thread only.
+    void Reset(int32_t x, int32_t y)
+    {
+        X = x;
+        Y = y;
+        State = ChunkState::GENERATING;
+        Cancelled = false;
+        RemeshPending = false;
+        TerrainTop = Height;
+        WaterBottom = 0;
+        WaterTop = Height;
+        for(auto& section : Sections)
+            section.Fill(BlockType::AIR);
+        for(auto& border : Borders)
+            border.Present = false;
+        Mesh.Clear();
+        ReleaseGLObjs();
+    }
+
+    void ReleaseGLObjs()
+    {
+        TerrainMesh.Reset();
+        WaterMesh.Reset();
+    }
+
+    static constexpr size_t BlockCount = (size_t)Size * Height * Size;
+    // What the blocks took as a plain [x][y][z] array before palette compression.
+    static constexpr size_t DenseBlockBytes = BlockCount * sizeof(BlockType);
+
+    BlockType GetBlock(int x, int y, int z) const
+    {
+        return Sections[y / SectionHeight].Blocks.Get(Section::BlockIndex(x, y % SectionHeight, z));
+    }
+
+    void SetBlock(int x, int y, int z, BlockType type)
+    {
+        Sections[y / SectionHeight].Blocks.Set(Section::BlockIndex(x, y % SectionHeight, z), type);
+    }
+
+    size_t BlockMemoryUsage() const
+    {
+        size_t bytes = sizeof(Sections);
+        for(const auto& section : Sections)
+            bytes += section.Blocks.MemoryUsage();
+        return bytes;
+    }
+
+    // Whether a face of block on the chunk edge facing side is visible. along
+    // is z for the x sides and x for the z sides. Faces toward a neighbor
+    // that isn't known yet are kept.
+    bool EdgeFaceVisible(ChunkSide side, int y, int along, BlockType block) const
+    {
+        const Border& border = Borders[(int)side];
+        if(!border.Present)
+            return true;
+
+        const uint64_t bit = 1ull << along;
+        return block == BlockType::WATER ? !(border.Water[y] & bit) : !(border.Solid[y] & bit);
+    }
+
+    // Copies this chunk's edge layer on side into border, for the neighbor
+    // across that side.
+    void ExtractBorder(ChunkSide side, Border& border) const
+    {
+        const bool xSide = side == ChunkSide::NEG_X || side == ChunkSide::POS_X;
+        const int edge = side == ChunkSide::NEG_X || side == ChunkSide::NEG_Z ? 0 : Size - 1;
+
+        for(int y = 0; y < Height; ++y)
+        {
+            const Section& section = Sections[y / SectionHeight];
+            const int localY = y % SectionHeight;
+            if(section.Uniform())
+            {
+                const BlockType type = section.UniformType();
+                border.Solid[y] = type != BlockType::AIR ? FullRow : 0;
+                border.Water[y] = type == BlockType::WATER ? FullRow : 0;
+            }
+            else if(xSide)
+            {
+                border.Solid[y] = ~section.ZRow(edge, localY, BlockType::AIR) & FullRow;
+                border.Water[y] = section.ZRow(edge, localY, BlockType::WATER);
+            }
+            else
+            {
+                uint64_t solid = 0;
+                uint64_t water = 0;
+                for(int x = 0; x < Size; ++x)
+                {
+                    const BlockType type = section.Blocks.Get(Section::BlockIndex(x, localY, edge));
+                    solid |= (uint64_t)(type != BlockType::AIR) << x;
+                    water |= (uint64_t)(type == BlockType::WATER) << x;
+                }
+                border.Solid[y] = solid;
+                border.Water[y] = water;
+            }
+        }
+        border.Present = true;
+    }
+
+    int UniformSectionCount() const
+    {
+        int count = 0;
+        for(const auto& section : Sections)
+            count += section.Uniform() ? 1 : 0;
+        return count;
+    }
+};
+
+// Layout the world's chunks are stored in. The others are built for the
+// layout benchmark.
+using DefaultBlockLayout = ZRowLayout<ChunkSize, SectionHeight>;
+using ChunkSection = BasicChunkSection<ChunkSize, DefaultBlockLayout>;
+using ChunkBorder = BasicChunkBorder<ChunkHeight>;
+using Chunk = BasicChunk<ChunkSize, ChunkHeight, DefaultBlockLayout>;
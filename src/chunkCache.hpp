@@ -0,0 +1,194 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "chunk.hpp"
+#include "chunkMap.hpp"
+#include "mesher.hpp"
+
+
+struct ChunkCacheStats
+{
+    size_t Hits = 0;
+    size_t Misses = 0;
+    // Hits whose cached mesh could be uploaded as is.
+    size_t MeshesReused = 0;
+    size_t Evictions = 0;
+
+    float HitRate() const { return Hits + Misses ? (float)Hits / (Hits + Misses) : 0.0f; }
+};
+
+// Byte-bounded LRU cache of chunks that left the loaded area. Entries keep
+// their block data and, optionally, their CPU side mesh, so a chunk the
+// camera returns to doesn't have to be generated (or even meshed) again.
+// Entries sit in a slot array linked into a recency list; a ChunkMap maps
+// coordinates to slots. Main thread only.
+class ChunkCache
+{
+public:
+    ChunkCache(size_t capacityBytes, bool keepMeshes)
+        : m_CapacityBytes(capacityBytes), m_KeepMeshes(keepMeshes)
+    {}
+
+    size_t CapacityBytes() const { return m_CapacityBytes; }
+    size_t UsedBytes() const { return m_UsedBytes; }
+    size_t Count() const { return m_Index.Size(); }
+    bool KeepMeshes() const { return m_KeepMeshes; }
+    const ChunkCacheStats& Stats() const { return m_Stats; }
+    void ResetStats() { m_Stats = ChunkCacheStats(); }
+
+    // Chunks pushed out to get back under the budget are passed to evicted.
+    template<typename EvictFn>
+    void SetCapacityBytes(size_t bytes, EvictFn&& evicted)
+    {
+        m_CapacityBytes = bytes;
+        Trim(evicted);
+    }
+
+    // Only affects chunks inserted from now on.
+    void SetKeepMeshes(bool keep) { m_KeepMeshes = keep; }
+
+    // Takes a ready chunk whose GL objects were already released. meshMode is
+    // the mode its mesh was built with.
+    template<typename EvictFn>
+    void Insert(std::unique_ptr<Chunk> chunk, MeshMode meshMode, EvictFn&& evicted)
+    {
+        if(!m_KeepMeshes)
+            chunk->Mesh = ChunkMesh();
+
+        Entry entry;
+        entry.Bytes = chunk->BlockMemoryUsage() + (m_KeepMeshes ? chunk->Mesh.MemoryUsage() : 0);
+        entry.HasMesh = m_KeepMeshes;
+        entry.Mode = meshMode;
+        if(entry.Bytes > m_CapacityBytes)
+        {
+            ++m_Stats.Evictions;
+            evicted(std::move(chunk));
+            return;
+        }
+
+        const int32_t x = chunk->X;
+        const int32_t y = chunk->Y;
+        entry.Value = std::move(chunk);
+
+        int slot;
+        if(m_FreeSlots.empty())
+        {
+            slot = (int)m_Entries.size();
+            m_Entries.push_back(std::move(entry));
+        }
+        else
+        {
+            slot = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+            m_Entries[slot] = std::move(entry);
+        }
+
+        m_UsedBytes += m_Entries[slot].Bytes;
+        m_Index.Insert(x, y, slot);
+        LinkFront(slot);
+        Trim(evicted);
+    }
+
+    // Returns the cached chunk at (x, y), or nullptr. meshReusable is set when
+    // the cached mesh was built with meshMode and can be uploaded directly.
+    std::unique_ptr<Chunk> Take(int32_t x, int32_t y, MeshMode meshMode, bool& meshReusable)
+    {
+        meshReusable = false;
+        const int* slot = m_Index.Find(x, y);
+        if(!slot)
+        {
+            ++m_Stats.Misses;
+            return nullptr;
+        }
+
+        Entry& entry = m_Entries[*slot];
+        meshReusable = entry.HasMesh && entry.Mode == meshMode;
+        ++m_Stats.Hits;
+        if(meshReusable)
+            ++m_Stats.MeshesReused;
+
+        return Remove(*slot);
+    }
+
+    template<typename EvictFn>
+    void Clear(EvictFn&& evicted)
+    {
+        while(m_Tail >= 0)
+            evicted(Remove(m_Tail));
+    }
+
+private:
+    struct Entry
+    {
+        std::unique_ptr<Chunk> Value;
+        size_t Bytes = 0;
+        MeshMode Mode = MeshMode::NAIVE;
+        bool HasMesh = false;
+        // Neighbors in the recency list, most recent first.
+        int Prev = -1;
+        int Next = -1;
+    };
+
+    template<typename EvictFn>
+    void Trim(EvictFn& evicted)
+    {
+        while(m_UsedBytes > m_CapacityBytes && m_Tail >= 0)
+        {
+            ++m_Stats.Evictions;
+            evicted(Remove(m_Tail));
+        }
+    }
+
+    std::unique_ptr<Chunk> Remove(int slot)
+    {
+        Entry& entry = m_Entries[slot];
+        Unlink(slot);
+        m_Index.Erase(entry.Value->X, entry.Value->Y);
+        m_UsedBytes -= entry.Bytes;
+        m_FreeSlots.push_back(slot);
+        return std::move(entry.Value);
+    }
+
+    void LinkFront(int slot)
+    {
+        Entry& entry = m_Entries[slot];
+        entry.Prev = -1;
+        entry.Next = m_Head;
+        if(m_Head >= 0)
+            m_Entries[m_Head].Prev = slot;
+        m_Head = slot;
+        if(m_Tail < 0)
+            m_Tail = slot;
+    }
+
+    void Unlink(int slot)
+    {
+        Entry& entry = m_Entries[slot];
+        if(entry.Prev >= 0)
+            m_Entries[entry.Prev].Next = entry.Next;
+        else
+            m_Head = entry.Next;
+
+        if(entry.Next >= 0)
+            m_Entries[entry.Next].Prev = entry.Prev;
+        else
+            m_Tail = entry.Prev;
+
+        entry.Prev = -1;
+        entry.Next = -1;
+    }
+
+private:
+    std::vector<Entry> m_Entries;
+    std::vector<int> m_FreeSlots;
+    ChunkMap<int> m_Index;
+    int m_Head = -1;
+    int m_Tail = -1;
+
+    size_t m_CapacityBytes;
+    size_t m_UsedBytes = 0;
+    bool m_KeepMeshes;
+    ChunkCacheStats m_Stats;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+// Fixed size toroidal grid of chunks. Chunk (x, y) always lives in slot
+// (x mod Side, y mod Side), so any Side x Side window of chunks maps onto the
+// grid without collisions and lookups, including neighbor lookups, are plain
+// arithmetic. When the window moves by one chunk the row or column leaving it
+// occupies exactly the slots the entering one needs.
+template<typename T>
+class ChunkGrid
+{
+public:
+    ChunkGrid(int side)
+        : m_Side(side), m_Slots((size_t)side * side)
+    {}
+
+    int Side() const { return m_Side; }
+    size_t Size() const { return m_Size; }
+
+    T* Find(int32_t x, int32_t y)
+    {
+        Slot& slot = SlotAt(x, y);
+        return slot.Used && slot.X == x && slot.Y == y ? &slot.Value : nullptr;
+    }
+
+    const T* Find(int32_t x, int32_t y) const
+    {
+        const Slot& slot = m_Slots[SlotIndex(x, y)];
+        return slot.Used && slot.X == x && slot.Y == y ? &slot.Value : nullptr;
+    }
+
+    bool Contains(int32_t x, int32_t y) const { return Find(x, y) != nullptr; }
+
+    // The slot must be free or already hold (x, y); whatever left the window
+    // has to be erased first.
+    T& Insert(int32_t x, int32_t y, T value)
+    {
+        Slot& slot = SlotAt(x, y);
+        assert(!slot.Used || (slot.X == x && slot.Y == y));
+        if(!slot.Used)
+            ++m_Size;
+
+        slot.X = x;
+        slot.Y = y;
+        slot.Used = true;
+        slot.Value = std::move(value);
+        return slot.Value;
+    }
+
+    bool Erase(int32_t x, int32_t y)
+    {
+        Slot& slot = SlotAt(x, y);
+        if(!slot.Used || slot.X != x || slot.Y != y)
+            return false;
+
+        slot.Used = false;
+        slot.Value = T{};
+        --m_Size;
+        return true;
+    }
+
+    // Calls fn(x, y, value) for every entry.
+    template<typename Fn>
+    void ForEach(Fn&& fn)
+    {
+        for(Slot& slot : m_Slots)
+        {
+            if(slot.Used)
+                fn(slot.X, slot.Y, slot.Value);
+        }
+    }
+
+    template<typename Fn>
+    void ForEach(Fn&& fn) const
+    {
+        for(const Slot& slot : m_Slots)
+        {
+            if(slot.Used)
+                fn(slot.X, slot.Y, slot.Value);
+        }
+    }
+
+    // Erases every entry for which pred(x, y, value) returns true.
+    template<typename Pred>
+    void EraseIf(Pred&& pred)
+    {
+        for(Slot& slot : m_Slots)
+        {
+            if(slot.Used && pred(slot.X, slot.Y, slot.Value))
+            {
+                slot.Used = false;
+                slot.Value = T{};
+                --m_Size;
+            }
+        }
+    }
+
+    void Clear()
+    {
+        for(Slot& slot : m_Slots)
+        {
+            slot.Used = false;
+            slot.Value = T{};
+        }
+        m_Size = 0;
+    }
+
+private:
+    struct Slot
+    {
+        int32_t X = 0;
+        int32_t Y = 0;
+        bool Used = false;
+        T Value{};
+    };
+
+    size_t SlotIndex(int32_t x, int32_t y) const
+    {
+        int sx = x % m_Side;
+        int sy = y % m_Side;
+        if(sx < 0) sx += m_Side;
+        if(sy < 0) sy += m_Side;
+        return (size_t)sx * m_Side + sy;
+    }
+
+    Slot& SlotAt(int32_t x, int32_t y) { return m_Slots[SlotIndex(x, y)]; }
+
+private:
+    int m_Side;
+    std::vector<Slot> m_Slots;
+    size_t m_Size = 0;
+};
@@ -0,0 +1,311 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "util.hpp"
+
+
+// Both chunk coordinates packed into one 64-bit key.
+inline uint64_t PackChunkKey(int32_t x, int32_t y)
+{
+    return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+}
+
+// splitmix64 finalizer. Every input bit affects every output bit, so keys that
+// only differ in x, or that are swapped, still land far apart.
+inline uint64_t HashChunkKey(uint64_t key)
+{
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ull;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBull;
+    key ^= key >> 31;
+    return key;
+}
+
+// Open-addressing hash table from chunk coordinates to T. Keys and values sit
+// in two flat arrays so a probe only walks contiguous keys. Linear probing
+// with backward-shift deletion, so there are no tombstones and erasing never
+// makes later lookups slower. The capacity is a power of two and grows to
+// keep the load factor at or below one half.
+template<typename T>
+class ChunkMap
+{
+public:
+    ChunkMap(size_t capacity = 16)
+    {
+        size_t size = 16;
+        while(size < capacity * 2)
+            size <<= 1;
+        Allocate(size);
+    }
+
+    size_t Size() const { return m_Size; }
+    size_t Capacity() const { return m_Keys.size(); }
+
+    T* Find(int32_t x, int32_t y)
+    {
+        size_t slot = FindSlot(PackChunkKey(x, y));
+        return slot == NotFound ? nullptr : &m_Values[slot];
+    }
+
+    const T* Find(int32_t x, int32_t y) const
+    {
+        size_t slot = FindSlot(PackChunkKey(x, y));
+        return slot == NotFound ? nullptr : &m_Values[slot];
+    }
+
+    bool Contains(int32_t x, int32_t y) const { return FindSlot(PackChunkKey(x, y)) != NotFound; }
+
+    // Inserts or overwrites the value at (x, y).
+    T& Insert(int32_t x, int32_t y, T value)
+    {
+        if((m_Size + 1) * 2 > m_Keys.size())
+            Grow();
+
+        const uint64_t key = PackChunkKey(x, y);
+        size_t slot = HashChunkKey(key) & m_Mask;
+        while(m_Keys[slot] != EmptyKey)
+        {
+            if(m_Keys[slot] == key)
+            {
+                m_Values[slot] = std::move(value);
+                return m_Values[slot];
+            }
+            slot = (slot + 1) & m_Mask;
+        }
+
+        m_Keys[slot] = key;
+        m_Values[slot] = std::move(value);
+        ++m_Size;
+        return m_Values[slot];
+    }
+
+    bool Erase(int32_t x, int32_t y)
+    {
+        size_t slot = FindSlot(PackChunkKey(x, y));
+        if(slot == NotFound)
+            return false;
+
+        EraseSlot(slot);
+        return true;
+    }
+
+    // Calls fn(x, y, value) for every entry.
+    template<typename Fn>
+    void ForEach(Fn&& fn)
+    {
+        for(size_t slot = 0; slot < m_Keys.size(); ++slot)
+        {
+            if(m_Keys[slot] != EmptyKey)
+                fn(UnpackX(m_Keys[slot]), UnpackY(m_Keys[slot]), m_Values[slot]);
+        }
+    }
+
+    template<typename Fn>
+    void ForEach(Fn&& fn) const
+    {
+        for(size_t slot = 0; slot < m_Keys.size(); ++slot)
+        {
+            if(m_Keys[slot] != EmptyKey)
+                fn(UnpackX(m_Keys[slot]), UnpackY(m_Keys[slot]), m_Values[slot]);
+        }
+    }
+
+    // Erases every entry for which pred(x, y, value) returns true. pred may
+    // move from the value before returning true.
+    template<typename Pred>
+    void EraseIf(Pred&& pred)
+    {
+        size_t slot = 0;
+        while(slot < m_Keys.size())
+        {
+            // Backward shifting only ever moves entries into the freed slot
+            // or into ones not yet visited, so the slot is checked again.
+            if(m_Keys[slot] != EmptyKey && pred(UnpackX(m_Keys[slot]), UnpackY(m_Keys[slot]), m_Values[slot]))
+                EraseSlot(slot);
+            else
+                ++slot;
+        }
+    }
+
+    void Clear()
+    {
+        std::fill(m_Keys.begin(), m_Keys.end(), EmptyKey);
+        for(auto& value : m_Values)
+            value = T{};
+        m_Size = 0;
+    }
+
+private:
+    // Chunk (INT32_MIN, INT32_MIN) is far outside any reachable world, so its
+    // key marks free slots.
+    static constexpr uint64_t EmptyKey = ((uint64_t)(uint32_t)INT32_MIN << 32) | (uint32_t)INT32_MIN;
+    static constexpr size_t NotFound = ~(size_t)0;
+
+    static int32_t UnpackX(uint64_t key) { return (int32_t)(uint32_t)(key >> 32); }
+    static int32_t UnpackY(uint64_t key) { return (int32_t)(uint32_t)key; }
+
+    size_t FindSlot(uint64_t key) const
+    {
+        size_t slot = HashChunkKey(key) & m_Mask;
+        while(m_Keys[slot] != EmptyKey)
+        {
+            if(m_Keys[slot] == key)
+                return slot;
+            slot = (slot + 1) & m_Mask;
+        }
+        return NotFound;
+    }
+
+    // Pulls following entries of the probe run back into the hole so every
+    // entry stays reachable from its home slot.
+    void EraseSlot(size_t hole)
+    {
+        size_t slot = hole;
+        for(;;)
+        {
+            slot = (slot + 1) & m_Mask;
+            if(m_Keys[slot] == EmptyKey)
+                break;
+
+            size_t home = HashChunkKey(m_Keys[slot]) & m_Mask;
+            // Only move the entry if its home is not inside (hole, slot].
+            if(((slot - home) & m_Mask) >= ((slot - hole) & m_Mask))
+            {
+                m_Keys[hole] = m_Keys[slot];
+                m_Values[hole] = std::move(m_Values[slot]);
+                hole = slot;
+            }
+        }
+
+        m_Keys[hole] = EmptyKey;
+        m_Values[hole] = T{};
+        --m_Size;
+    }
+
+    void Allocate(size_t size)
+    {
+        m_Keys.assign(size, EmptyKey);
+        m_Values.clear();
+        m_Values.resize(size);
+        m_Mask = size - 1;
+        m_Size = 0;
+    }
+
+    void Grow()
+    {
+        std::vector<uint64_t> oldKeys = std::move(m_Keys);
+        std::vector<T> oldValues = std::move(m_Values);
+        Allocate(oldKeys.size() * 2);
+
+        for(size_t i = 0; i < oldKeys.size(); ++i)
+        {
+            if(oldKeys[i] != EmptyKey)
+                Insert(UnpackX(oldKeys[i]), UnpackY(oldKeys[i]), std::move(oldValues[i]));
+        }
+    }
+
+private:
+    std::vector<uint64_t> m_Keys;
+    std::vector<T> m_Values;
+    size_t m_Mask = 0;
+    size_t m_Size = 0;
+};
+
+struct ChunkMapStats
+{
+    int Radius = 0;
+    // Millions of operations per second.
+    float LookupRate = 0.0f;
+    float UpdateRate = 0.0f;
+    float BaselineLookupRate = 0.0f;
+    float BaselineUpdateRate = 0.0f;
+};
+
+static const std::array<int, 3> ChunkMapBenchmarkRadii = { 5, 16, 32 };
+
+// Compares ChunkMap against the std::unordered_map with an XOR pair hash it
+// replaced. Lookups probe every chunk of a (2 * radius + 1)^2 window; updates
+// walk the window along x, inserting the leading column and erasing the
+// trailing one each step, like a camera flying in a straight line.
+inline ChunkMapStats MeasureChunkMap(int radius, int rounds = 20)
+{
+    struct XorPairHash
+    {
+        size_t operator()(const std::pair<int32_t, int32_t>& p) const
+        {
+            return std::hash<int32_t>{}(p.first) ^ std::hash<int32_t>{}(p.second);
+        }
+    };
+
+    const int side = 2 * radius + 1;
+    const size_t lookups = (size_t)side * side * rounds;
+    const size_t updates = (size_t)side * 2 * rounds * 4;
+    int dummy = 1;
+
+    ChunkMapStats stats;
+    stats.Radius = radius;
+
+    {
+        ChunkMap<int*> map;
+        for(int x = -radius; x <= radius; ++x)
+            for(int y = -radius; y <= radius; ++y)
+                map.Insert(x, y, &dummy);
+
+        size_t found = 0;
+        Timer timer;
+        for(int r = 0; r < rounds; ++r)
+            for(int x = -radius; x <= radius; ++x)
+                for(int y = -radius; y <= radius; ++y)
+                    found += map.Find(x, y) != nullptr;
+        float elapsed = timer.Elapsed();
+        stats.LookupRate = found == lookups ? lookups / elapsed * 1e-6f : 0.0f;
+
+        timer.Start();
+        for(int step = 0; step < rounds * 4; ++step)
+        {
+            for(int y = -radius; y <= radius; ++y)
+            {
+                map.Insert(step + radius + 1, y, &dummy);
+                map.Erase(step - radius, y);
+            }
+        }
+        stats.UpdateRate = updates / timer.Elapsed() * 1e-6f;
+    }
+
+    {
+        std::unordered_map<std::pair<int32_t, int32_t>, int*, XorPairHash> map;
+        for(int x = -radius; x <= radius; ++x)
+            for(int y = -radius; y <= radius; ++y)
+                map[{x, y}] = &dummy;
+
+        size_t found = 0;
+        Timer timer;
+        for(int r = 0; r < rounds; ++r)
+            for(int x = -radius; x <= radius; ++x)
+                for(int y = -radius; y <= radius; ++y)
+                    found += map.find({x, y}) != map.end();
+        float elapsed = timer.Elapsed();
+        stats.BaselineLookupRate = found == lookups ? lookups / elapsed * 1e-6f : 0.0f;
+
+        timer.Start();
+        for(int step = 0; step < rounds * 4; ++step)
+        {
+            for(int y = -radius; y <= radius; ++y)
+            {
+                map[{step + radius + 1, y}] = &dummy;
+                map.erase({step - radius, y});
+            }
+        }
+        stats.BaselineUpdateRate = updates / timer.Elapsed() * 1e-6f;
+    }
+
+    return stats;
+}
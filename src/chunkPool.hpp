@@ -0,0 +1,60 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "chunk.hpp"
+
+
+// Free list of unloaded chunks. Acquire hands back a recycled chunk when one
+// is available, so block storage and mesh vectors keep the capacity they grew
+// to and streaming doesn't allocate them again. Main thread only.
+class ChunkPool
+{
+public:
+    ChunkPool(size_t maxFree)
+        : m_MaxFree(maxFree)
+    {
+        m_Free.reserve(maxFree);
+    }
+
+    std::unique_ptr<Chunk> Acquire(int32_t x, int32_t y)
+    {
+        if(m_Free.empty())
+        {
+            ++m_Allocated;
+            return std::make_unique<Chunk>(x, y);
+        }
+
+        std::unique_ptr<Chunk> chunk = std::move(m_Free.back());
+        m_Free.pop_back();
+        chunk->Reset(x, y);
+        ++m_Recycled;
+        return chunk;
+    }
+
+    // Chunks beyond maxFree are freed outright. A pooled chunk never owns GPU
+    // memory: its mesh ranges go back to the arena here, not whenever Acquire
+    // happens to pick it again.
+    void Release(std::unique_ptr<Chunk> chunk)
+    {
+        if(!chunk)
+            return;
+
+        chunk->ReleaseGLObjs();
+        if(m_Free.size() < m_MaxFree)
+        {
+            m_Free.push_back(std::move(chunk));
+        }
+    }
+
+    size_t FreeCount() const { return m_Free.size(); }
+    size_t AllocatedCount() const { return m_Allocated; }
+    size_t RecycledCount() const { return m_Recycled; }
+
+private:
+    std::vector<std::unique_ptr<Chunk>> m_Free;
+    size_t m_MaxFree;
+    size_t m_Allocated = 0;
+    size_t m_Recycled = 0;
+};
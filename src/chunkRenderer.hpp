@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <glad/gl.h>
+#include "chunk.hpp"
+#include "glResourceManager.hpp"
+#include "graphics.hpp"
+#include "meshArena.hpp"
+#include "stagingRing.hpp"
+
+
+// Static index buffer shared by every chunk draw. Quad q is drawn as the
+// triangles (4q, 4q+1, 4q+2) and (4q, 4q+2, 4q+3). The buffer grows to the
+// largest quad count uploaded so far, up to one batch of 16-bit indices;
+// larger meshes are drawn batch by batch with a base vertex.
+class QuadIndexBuffer
+{
+public:
+    // 65536 vertices, all a 16-bit index can reach.
+    static const unsigned int BatchQuads = 16384;
+
+    // Makes sure meshes of quadCount quads can be drawn and returns the buffer.
+    unsigned int Reserve(size_t quadCount)
+    {
+        size_t quads = std::min<size_t>(quadCount, BatchQuads);
+        if(m_Buffer && quads <= m_Quads)
+            return m_Buffer.Get();
+
+        size_t size = 1024;
+        while(size < quads)
+            size <<= 1;
+
+        std::vector<uint16_t> indices(size * 6);
+        for(size_t q = 0; q < size; ++q)
+        {
+            const uint16_t base = (uint16_t)(q * 4);
+            uint16_t* out = &indices[q * 6];
+            out[0] = base;
+            out[1] = (uint16_t)(base + 1);
+            out[2] = (uint16_t)(base + 2);
+            out[3] = base;
+            out[4] = (uint16_t)(base + 2);
+            out[5] = (uint16_t)(base + 3);
+        }
+
+        // Vertex arrays refer to the buffer by name, so respecifying its
+        // storage keeps them working. The copy target is used so whatever
+        // vertex array happens to be bound doesn't pick the buffer up.
+        if(!m_Buffer)
+        {
+            unsigned int buffer;
+            glGenBuffers(1, &buffer);
+            m_Buffer.Reset(buffer);
+        }
+        BindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer.Get());
+        glBufferData(GL_COPY_WRITE_BUFFER, sizeof(uint16_t) * indices.size(), indices.data(), GL_STATIC_DRAW);
+        m_Quads = size;
+        return m_Buffer.Get();
+    }
+
+    size_t Quads() const { return m_Quads; }
+    size_t MemoryUsage() const { return m_Quads * 6 * sizeof(uint16_t); }
+
+private:
+    BufferHandle m_Buffer;
+    size_t m_Quads = 0;
+};
+
+enum class ChunkPass : uint8_t
+{
+    TERRAIN = 0,
+    WATER,
+};
+
+// Layout glMultiDrawElementsIndirect reads commands in.
+struct DrawElementsIndirectCommand
+{
+    uint32_t Count;
+    uint32_t InstanceCount;
+    uint32_t FirstIndex;
+    int32_t BaseVertex;
+    uint32_t BaseInstance;
+};
+
+// Owns the GPU side of every chunk mesh. Meshes are sub-allocated from one
+// MeshArena and all share one vertex array, so a whole pass is drawn with a
+// single glMultiDrawElementsIndirect. Each command's base instance selects
+// the chunk's origin from a per-draw instanced attribute, which replaces the
+// per-chunk model matrix. Buffers come from a GLResourceManager, which
+// recycles them once the frames using them are done. Main thread only.
+class ChunkRenderer
+{
+public:
+    // Room for the meshes around the camera before the arena has to grow.
+    static const uint32_t InitialArenaVertices = 1u << 22;
+
+    // Meshes are staged through a ring this large; bigger ones are uploaded
+    // with glBufferSubData.
+    static const size_t StagingBytes = 16u << 20;
+
+    // Uploads chunk.Mesh, replacing whatever the chunk had uploaded before.
+    // Returns false, leaving the chunk untouched, when the staging ring has
+    // no room left until earlier copies complete.
+    bool Upload(Chunk& chunk)
+    {
+        const ChunkMesh& mesh = chunk.Mesh;
+        const size_t terrainBytes = mesh.Vertices.size() * sizeof(ChunkVertex);
+        const size_t waterBytes = mesh.WaterVertices.size() * sizeof(ChunkVertex);
+
+        size_t stagingOffset = 0;
+        const bool staged = terrainBytes + waterBytes <= m_Staging.Capacity();
+        if(staged && !m_Staging.Reserve(terrainBytes + waterBytes, stagingOffset))
+        {
+            ++m_UploadStats.Stalls;
+            return false;
+        }
+
+        m_QuadIndices.Reserve(std::max(mesh.Vertices.size(), mesh.WaterVertices.size()) / 4);
+        MeshAllocation terrain = m_Arena.Allocate((uint32_t)mesh.Vertices.size());
+        MeshAllocation water = m_Arena.Allocate((uint32_t)mesh.WaterVertices.size());
+
+        if(staged)
+        {
+            // The mapping is coherent, so the copies see these writes
+            // without a flush.
+            uint8_t* out = m_Staging.Data() + stagingOffset;
+            std::memcpy(out, mesh.Vertices.data(), terrainBytes);
+            std::memcpy(out + terrainBytes, mesh.WaterVertices.data(), waterBytes);
+            m_Arena.CopyFrom(m_Staging.Buffer(), stagingOffset, terrain);
+            m_Arena.CopyFrom(m_Staging.Buffer(), stagingOffset + terrainBytes, water);
+        }
+        else
+        {
+            m_Arena.Upload(terrain, mesh.Vertices.data());
+            m_Arena.Upload(water, mesh.WaterVertices.data());
+            ++m_UploadStats.Direct;
+        }
+
+        m_UploadStats.Bytes += terrainBytes + waterBytes;
+        ++m_UploadStats.Chunks;
+
+        chunk.TerrainMesh = std::move(terrain);
+        chunk.WaterMesh = std::move(water);
+        return true;
+    }
+
+    // Bracket a frame's uploads: Begin reclaims staging space and buffers the
+    // GPU is done with and resets the frame's upload stats, End fences this
+    // frame's copies.
+    void BeginUploads()
+    {
+        m_Resources.BeginFrame();
+        m_Staging.Reclaim();
+        m_UploadStats = UploadStats();
+    }
+
+    void EndUploads()
+    {
+        m_Staging.Fence();
+    }
+
+    // Call after the frame's last Draw. Mesh ranges and buffers released
+    // during the frame are reused once the GPU has finished it.
+    void EndFrame()
+    {
+        m_Resources.EndFrame();
+    }
+
+    // Draws one pass of the given chunks. The bound program reads the packed
+    // vertex at location 0 and the chunk origin, in blocks, at location 1.
+    void Draw(const std::vector<const Chunk*>& chunks, ChunkPass pass)
+    {
+        m_Commands.clear();
+        m_Origins.clear();
+        for(const Chunk* chunk : chunks)
+        {
+            const MeshAllocation& mesh = pass == ChunkPass::WATER ? chunk->WaterMesh : chunk->TerrainMesh;
+            if(!mesh)
+                continue;
+
+            const uint32_t origin = (uint32_t)(m_Origins.size() / 2);
+            m_Origins.push_back(chunk->X * ChunkSize);
+            m_Origins.push_back(chunk->Y * ChunkSize);
+
+            const uint32_t quads = mesh.Count() / 4;
+            for(uint32_t first = 0; first < quads; first += QuadIndexBuffer::BatchQuads)
+            {
+                const uint32_t count = std::min(quads - first, QuadIndexBuffer::BatchQuads);
+                m_Commands.push_back({ count * 6, 1, 0, (int32_t)(mesh.Offset() + first * 4), origin });
+            }
+        }
+
+        m_DrawCommands[(int)pass] = m_Commands.size();
+        if(m_Commands.empty())
+            return;
+
+        PrepareVertexArray();
+
+        // Both buffers are filled fresh every draw, so each draw takes
+        // recycled ones instead of respecifying the storage of the last.
+        const size_t originBytes = sizeof(int32_t) * m_Origins.size();
+        const size_t commandBytes = sizeof(DrawElementsIndirectCommand) * m_Commands.size();
+        const PooledBuffer origins = m_Resources.AcquireBuffer(originBytes, BufferUsage::STREAM);
+        const PooledBuffer commands = m_Resources.AcquireBuffer(commandBytes, BufferUsage::STREAM);
+
+        BindVertexBuffer(origins.Id);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)originBytes, m_Origins.data());
+        AddVertexAttribInt(m_Vao.Get(), 1, VertexAttribType::INT, 2, sizeof(int32_t) * 2, 0);
+        BindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.Id);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, (GLsizeiptr)commandBytes, m_Commands.data());
+
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, nullptr, (GLsizei)m_Commands.size(), 0);
+
+        m_Resources.ReleaseBuffer(origins);
+        m_Resources.ReleaseBuffer(commands);
+    }
+
+    struct UploadStats
+    {
+        size_t Chunks = 0;
+        size_t Bytes = 0;
+        // Meshes too big for the ring, uploaded with glBufferSubData.
+        size_t Direct = 0;
+        // Uploads put off because the ring was full.
+        size_t Stalls = 0;
+    };
+
+    // Uploads since the last BeginUploads.
+    const UploadStats& GetUploadStats() const { return m_UploadStats; }
+    const GLResourceStats& ResourceStats() const { return m_Resources.Stats(); }
+    const StagingRing& Staging() const { return m_Staging; }
+    const MeshArena& Arena() const { return m_Arena; }
+    const QuadIndexBuffer& QuadIndices() const { return m_QuadIndices; }
+    // Indirect commands submitted by the last Draw of the pass.
+    size_t DrawCommands(ChunkPass pass) const { return m_DrawCommands[(int)pass]; }
+
+private:
+    // Creates the shared vertex array on first use and points it at the
+    // arena again whenever the arena has moved to a bigger buffer.
+    void PrepareVertexArray()
+    {
+        if(!m_Vao)
+        {
+            // The origin attribute is pointed at its buffer by each Draw.
+            m_Vao.Reset(CreateVertexArray());
+            glVertexAttribDivisor(1, 1);
+            BindIndexBuffer(m_QuadIndices.Reserve(0));
+            m_ArenaGeneration = m_Arena.Generation() - 1;
+        }
+
+        BindVertexArray(m_Vao.Get());
+        if(m_ArenaGeneration != m_Arena.Generation())
+        {
+            BindVertexBuffer(m_Arena.Buffer());
+            AddVertexAttribInt(m_Vao.Get(), 0, VertexAttribType::UINT, 2, sizeof(ChunkVertex), 0);
+            m_ArenaGeneration = m_Arena.Generation();
+        }
+    }
+
+private:
+    // Declared first: everything below hands its buffers back to it.
+    GLResourceManager m_Resources;
+    MeshArena m_Arena{m_Resources, sizeof(ChunkVertex), InitialArenaVertices};
+    QuadIndexBuffer m_QuadIndices;
+    StagingRing m_Staging{StagingBytes};
+    UploadStats m_UploadStats;
+
+    VertexArrayHandle m_Vao;
+    uint32_t m_ArenaGeneration = 0;
+
+    std::vector<DrawElementsIndirectCommand> m_Commands;
+    std::vector<int32_t> m_Origins;
+    size_t m_DrawCommands[2] = {};
+};
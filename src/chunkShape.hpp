@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "chunk.hpp"
+#include "mesher.hpp"
+#include "noise.hpp"
+#include "terrainFill.hpp"
+#include "util.hpp"
+
+
+// Chunk dimensions, Size x Height x Size, that chunks, the fill and the
+// mesher are instantiated for besides the world's own. Picked at runtime
+// through VisitChunkShape to compare their throughput.
+enum class ChunkShape : uint8_t
+{
+    X16_Y256 = 0,
+    X32_Y100,
+    X32_Y128,
+    X64_Y256,
+};
+static const int ChunkShapeCount = 4;
+
+inline const char* ChunkShapeName(ChunkShape shape)
+{
+    switch(shape)
+    {
+        case ChunkShape::X16_Y256: return "16x256x16";
+        case ChunkShape::X32_Y100: return "32x100x32";
+        case ChunkShape::X32_Y128: return "32x128x32";
+        case ChunkShape::X64_Y256: return "64x256x64";
+        default: return "Unknown";
+    }
+}
+
+// Runs fn with a std::type_identity of the chunk type for shape, so code
+// templated on the dimensions can be picked at runtime. Every shape is
+// instantiated here and nowhere else.
+template<typename Fn>
+decltype(auto) VisitChunkShape(ChunkShape shape, Fn&& fn)
+{
+    switch(shape)
+    {
+        case ChunkShape::X16_Y256: return fn(std::type_identity<BasicChunk<16, 256>>{});
+        case ChunkShape::X32_Y128: return fn(std::type_identity<BasicChunk<32, 128>>{});
+        case ChunkShape::X64_Y256: return fn(std::type_identity<BasicChunk<64, 256>>{});
+        default: return fn(std::type_identity<BasicChunk<32, 100>>{});
+    }
+}
+
+// Width of the square of terrain every shape generates, in blocks. A
+// multiple of every shape's size, so they all cover the same columns.
+static const int ChunkShapeBenchmarkArea = 256;
+
+struct ChunkShapeStats
+{
+    int Size = 0;
+    int Height = 0;
+    int Chunks = 0;
+    // For the whole area, per pass.
+    double NoiseMs = 0.0;
+    double FillMs = 0.0;
+    double BorderMs = 0.0;
+    double MeshMs = 0.0;
+    size_t Vertices = 0;
+
+    double TotalMs() const { return NoiseMs + FillMs + BorderMs + MeshMs; }
+    // Terrain heights scale with the chunk height, so taller shapes hold more
+    // blocks over the same columns; columns are the fairer measure of how
+    // fast the world fills in.
+    double ColumnsPerSec() const
+    {
+        return TotalMs() > 0.0 ? (double)ChunkShapeBenchmarkArea * ChunkShapeBenchmarkArea / (TotalMs() / 1000.0) : 0.0;
+    }
+    double BlocksPerSec() const { return ColumnsPerSec() * Height; }
+};
+
+// Generates, fills, links and meshes a ChunkShapeBenchmarkArea square of
+// ChunkT chunks the way the world does: heights from one noise batch,
+// borders copied from each neighbor, binary meshes. One untimed pass first
+// sets up the chunks' storage and the mesher's scratch.
+template<typename ChunkT>
+inline ChunkShapeStats MeasureChunkShape(const NoiseGen& noise, int featureSize, int iterations)
+{
+    constexpr int Size = ChunkT::Size;
+    static_assert(ChunkShapeBenchmarkArea % Size == 0, "Every shape must tile the benchmark area");
+    const int count = ChunkShapeBenchmarkArea / Size;
+
+    // The world's noise settings, sampled a chunk of this shape at a time.
+    NoiseGen shapeNoise(noise.Octaves(), noise.Lacunarity(), noise.Gain(), noise.Seed(), Size, Size);
+    HeightmapBatch batch;
+
+    std::vector<std::unique_ptr<ChunkT>> chunks(count * count);
+    for(int y = 0; y < count; ++y)
+    {
+        for(int x = 0; x < count; ++x)
+            chunks[y * count + x] = std::make_unique<ChunkT>(x, y);
+    }
+
+    ChunkShapeStats stats;
+    stats.Size = Size;
+    stats.Height = ChunkT::Height;
+    stats.Chunks = count * count;
+
+    ChunkMesh mesh;
+    auto pass = [&](bool timed) {
+        Timer timer;
+        shapeNoise.GenerateNoise2D(0, 0, count, count, featureSize, batch);
+        const double noiseMs = timer.ElapsedMilli();
+
+        timer.Start();
+        for(auto& chunk : chunks)
+            FillChunkBlocks(*chunk, batch.View(chunk->X, chunk->Y));
+        const double fillMs = timer.ElapsedMilli();
+
+        timer.Start();
+        for(auto& chunk : chunks)
+        {
+            for(int side = 0; side < ChunkSideCount; ++side)
+            {
+                int dx, dy;
+                SideOffset((ChunkSide)side, dx, dy);
+                const int nx = chunk->X + dx;
+                const int ny = chunk->Y + dy;
+                if(nx >= 0 && nx < count && ny >= 0 && ny < count)
+                    chunks[ny * count + nx]->ExtractBorder(OppositeSide((ChunkSide)side), chunk->Borders[side]);
+                else
+                    chunk->Borders[side].Present = false;
+            }
+        }
+        const double borderMs = timer.ElapsedMilli();
+
+        size_t vertices = 0;
+        timer.Start();
+        for(auto& chunk : chunks)
+        {
+            GenerateChunkMeshBinary(*chunk, mesh);
+            vertices += mesh.VertexCount();
+        }
+        const double meshMs = timer.ElapsedMilli();
+
+        if(!timed)
+            return;
+        stats.NoiseMs += noiseMs / iterations;
+        stats.FillMs += fillMs / iterations;
+        stats.BorderMs += borderMs / iterations;
+        stats.MeshMs += meshMs / iterations;
+        stats.Vertices = vertices;
+    };
+
+    pass(false);
+    for(int i = 0; i < iterations; ++i)
+        pass(true);
+    return stats;
+}
+
+// Runs MeasureChunkShape for every shape over the same terrain.
+inline std::array<ChunkShapeStats, ChunkShapeCount> MeasureChunkShapes(const NoiseGen& noise, int featureSize, int iterations)
+{
+    std::array<ChunkShapeStats, ChunkShapeCount> shapes;
+    for(int shape = 0; shape < ChunkShapeCount; ++shape)
+    {
+        shapes[shape] = VisitChunkShape((ChunkShape)shape, [&](auto type) {
+            return MeasureChunkShape<typename decltype(type)::type>(noise, featureSize, iterations);
+        });
+    }
+    return shapes;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE 1
+#endif
+
+
+// View frustum as six planes (normal, distance) with normals pointing
+// inside: a point p is inside when dot(normal, p) + distance >= 0 for all of
+// them.
+struct Frustum
+{
+    std::array<glm::vec4, 6> Planes;
+
+    // Extracts the planes from a projection * view matrix (Gribb/Hartmann).
+    static Frustum FromMatrix(const glm::mat4& viewProj)
+    {
+        // glm is column major, so row i of the matrix is m[0][i] .. m[3][i].
+        auto row = [&viewProj](int i) {
+            return glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+        };
+
+        Frustum frustum;
+        frustum.Planes[0] = row(3) + row(0);
+        frustum.Planes[1] = row(3) - row(0);
+        frustum.Planes[2] = row(3) + row(1);
+        frustum.Planes[3] = row(3) - row(1);
+        frustum.Planes[4] = row(3) + row(2);
+        frustum.Planes[5] = row(3) - row(2);
+        for(glm::vec4& plane : frustum.Planes)
+            plane /= glm::length(glm::vec3(plane));
+        return frustum;
+    }
+};
+
+// Axis aligned boxes stored as one array per component, so a batch of them
+// can be tested against a frustum several boxes at a time.
+class AabbBatch
+{
+public:
+    void Clear()
+    {
+        for(auto& component : m_Components)
+            component.clear();
+    }
+
+    void Add(const glm::vec3& min, const glm::vec3& max)
+    {
+        for(int i = 0; i < 3; ++i)
+        {
+            m_Components[i].push_back(min[i]);
+            m_Components[i + 3].push_back(max[i]);
+        }
+    }
+
+    size_t Size() const { return m_Components[0].size(); }
+
+    // visible[i] is set to 1 when box i intersects the frustum and 0 when it
+    // lies entirely outside one of the planes. Conservative: boxes near a
+    // frustum corner may be reported visible.
+    void Test(const Frustum& frustum, std::vector<uint8_t>& visible) const
+    {
+        const size_t count = Size();
+        visible.resize(count);
+
+        const float* minX = m_Components[0].data();
+        const float* minY = m_Components[1].data();
+        const float* minZ = m_Components[2].data();
+        const float* maxX = m_Components[3].data();
+        const float* maxY = m_Components[4].data();
+        const float* maxZ = m_Components[5].data();
+
+        size_t i = 0;
+#ifdef FRUSTUM_SSE
+        // For each plane, the box corner furthest along its normal is found
+        // per axis as max(n * min, n * max); if even that corner is behind
+        // the plane, the whole box is.
+        for(; i + 4 <= count; i += 4)
+        {
+            const __m128 bMinX = _mm_loadu_ps(minX + i);
+            const __m128 bMinY = _mm_loadu_ps(minY + i);
+            const __m128 bMinZ = _mm_loadu_ps(minZ + i);
+            const __m128 bMaxX = _mm_loadu_ps(maxX + i);
+            const __m128 bMaxY = _mm_loadu_ps(maxY + i);
+            const __m128 bMaxZ = _mm_loadu_ps(maxZ + i);
+
+            __m128 outside = _mm_setzero_ps();
+            for(const glm::vec4& plane : frustum.Planes)
+            {
+                const __m128 nx = _mm_set1_ps(plane.x);
+                const __m128 ny = _mm_set1_ps(plane.y);
+                const __m128 nz = _mm_set1_ps(plane.z);
+                __m128 dist = _mm_set1_ps(plane.w);
+                dist = _mm_add_ps(dist, _mm_max_ps(_mm_mul_ps(nx, bMinX), _mm_mul_ps(nx, bMaxX)));
+                dist = _mm_add_ps(dist, _mm_max_ps(_mm_mul_ps(ny, bMinY), _mm_mul_ps(ny, bMaxY)));
+                dist = _mm_add_ps(dist, _mm_max_ps(_mm_mul_ps(nz, bMinZ), _mm_mul_ps(nz, bMaxZ)));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_setzero_ps()));
+            }
+
+            const int mask = _mm_movemask_ps(outside);
+            for(int k = 0; k < 4; ++k)
+                visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+        }
+#endif
+        for(; i < count; ++i)
+        {
+            bool inside = true;
+            for(const glm::vec4& plane : frustum.Planes)
+            {
+                const float dist = plane.w + std::max(plane.x * minX[i], plane.x * maxX[i]) +
+                    std::max(plane.y * minY[i], plane.y * maxY[i]) + std::max(plane.z * minZ[i], plane.z * maxZ[i]);
+                if(dist < 0.0f)
+                {
+                    inside = false;
+                    break;
+                }
+            }
+            visible[i] = inside ? 1 : 0;
+        }
+    }
+
+private:
+    // min x, y, z then max x, y, z.
+    std::array<std::vector<float>, 6> m_Components;
+};
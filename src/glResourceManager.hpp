@@ -0,0 +1,202 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <glad/gl.h>
+#include "graphics.hpp"
+
+
+enum class BufferUsage : uint8_t
+{
+    STATIC = 0,
+    STREAM,
+};
+static constexpr int BufferUsageCount = 2;
+
+// Buffer handed out by GLResourceManager. Bytes is the size of its storage,
+// the size class the request was rounded up to.
+struct PooledBuffer
+{
+    unsigned int Id = 0;
+    size_t Bytes = 0;
+    BufferUsage Usage = BufferUsage::STATIC;
+
+    explicit operator bool() const { return Id != 0; }
+};
+
+struct GLResourceStats
+{
+    // Every buffer the manager owns: in use, waiting on a fence or free.
+    size_t LiveBuffers = 0;
+    size_t LiveBytes = 0;
+    size_t FreeBuffers = 0;
+    size_t FreeBytes = 0;
+    // Released buffers the GPU may still be using.
+    size_t PendingBuffers = 0;
+    // Totals since startup.
+    size_t Created = 0;
+    size_t Recycled = 0;
+    size_t Deleted = 0;
+};
+
+// Hands out GL buffers in power of two size classes and takes them back
+// without deleting them. Frames are fenced: whatever is released during a
+// frame is kept untouched until that frame's fence signals, then goes to a
+// free list for its class, to be handed out again. Other owners of GPU memory
+// can follow the same rule through Frame() and FrameCompleted(). Main thread
+// only.
+class GLResourceManager
+{
+public:
+    // 4 KB, so tiny buffers share a class.
+    static const int MinSizeClass = 12;
+    static const int SizeClassCount = 40;
+    // Free buffers kept per class and usage; the rest are deleted.
+    static const size_t MaxFreePerClass = 8;
+
+    GLResourceManager() = default;
+    GLResourceManager(const GLResourceManager&) = delete;
+    GLResourceManager& operator=(const GLResourceManager&) = delete;
+
+    ~GLResourceManager()
+    {
+        for(const FrameFence& fence : m_Fences)
+            glDeleteSync(fence.Sync);
+        for(const PendingBuffer& pending : m_PendingBuffers)
+            DeleteBuffer(pending.Buffer.Id);
+        for(auto& usage : m_Free)
+            for(std::vector<PooledBuffer>& buffers : usage)
+                for(const PooledBuffer& buffer : buffers)
+                    DeleteBuffer(buffer.Id);
+    }
+
+    // Returns a buffer with room for at least bytes, with undefined contents.
+    PooledBuffer AcquireBuffer(size_t bytes, BufferUsage usage)
+    {
+        const int sizeClass = SizeClass(bytes);
+        std::vector<PooledBuffer>& free = m_Free[(int)usage][sizeClass];
+        if(!free.empty())
+        {
+            PooledBuffer buffer = free.back();
+            free.pop_back();
+            --m_Stats.FreeBuffers;
+            m_Stats.FreeBytes -= buffer.Bytes;
+            ++m_Stats.Recycled;
+            return buffer;
+        }
+
+        PooledBuffer buffer;
+        buffer.Bytes = (size_t)1 << sizeClass;
+        buffer.Usage = usage;
+        glGenBuffers(1, &buffer.Id);
+        BindBuffer(GL_COPY_WRITE_BUFFER, buffer.Id);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)buffer.Bytes, nullptr,
+                     usage == BufferUsage::STREAM ? GL_STREAM_DRAW : GL_STATIC_DRAW);
+
+        ++m_Stats.LiveBuffers;
+        m_Stats.LiveBytes += buffer.Bytes;
+        ++m_Stats.Created;
+        return buffer;
+    }
+
+    // The buffer may still be read by commands already issued, so it is only
+    // reused once the current frame's fence has signalled.
+    void ReleaseBuffer(const PooledBuffer& buffer)
+    {
+        if(!buffer)
+            return;
+        m_PendingBuffers.push_back({ buffer, m_Frame });
+        ++m_Stats.PendingBuffers;
+    }
+
+    // Checks which frames the GPU has finished and recycles what was
+    // released during them. Never waits.
+    void BeginFrame()
+    {
+        while(!m_Fences.empty())
+        {
+            const FrameFence& fence = m_Fences.front();
+            GLenum status = glClientWaitSync(fence.Sync, 0, 0);
+            if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                break;
+
+            glDeleteSync(fence.Sync);
+            m_CompletedFrame = fence.Frame;
+            m_Fences.pop_front();
+        }
+
+        while(!m_PendingBuffers.empty() && FrameCompleted(m_PendingBuffers.front().Frame))
+        {
+            Recycle(m_PendingBuffers.front().Buffer);
+            m_PendingBuffers.pop_front();
+            --m_Stats.PendingBuffers;
+        }
+    }
+
+    // Call once the frame's last command that may use released buffers is
+    // issued.
+    void EndFrame()
+    {
+        m_Fences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), m_Frame });
+        ++m_Frame;
+    }
+
+    // The frame currently being recorded.
+    uint64_t Frame() const { return m_Frame; }
+    // True once the GPU has finished every command issued during frame.
+    bool FrameCompleted(uint64_t frame) const { return frame <= m_CompletedFrame; }
+
+    const GLResourceStats& Stats() const { return m_Stats; }
+
+private:
+    struct PendingBuffer
+    {
+        PooledBuffer Buffer;
+        uint64_t Frame;
+    };
+
+    struct FrameFence
+    {
+        GLsync Sync;
+        uint64_t Frame;
+    };
+
+    static int SizeClass(size_t bytes)
+    {
+        int sizeClass = MinSizeClass;
+        while(((size_t)1 << sizeClass) < bytes)
+            ++sizeClass;
+        return sizeClass;
+    }
+
+    void Recycle(const PooledBuffer& buffer)
+    {
+        std::vector<PooledBuffer>& free = m_Free[(int)buffer.Usage][SizeClass(buffer.Bytes)];
+        if(free.size() < MaxFreePerClass)
+        {
+            free.push_back(buffer);
+            ++m_Stats.FreeBuffers;
+            m_Stats.FreeBytes += buffer.Bytes;
+            return;
+        }
+
+        DeleteBuffer(buffer.Id);
+        --m_Stats.LiveBuffers;
+        m_Stats.LiveBytes -= buffer.Bytes;
+        ++m_Stats.Deleted;
+    }
+
+private:
+    std::array<std::array<std::vector<PooledBuffer>, SizeClassCount>, BufferUsageCount> m_Free;
+    // In release order, so in frame order.
+    std::deque<PendingBuffer> m_PendingBuffers;
+    std::deque<FrameFence> m_Fences;
+    // Frame 0 counts as completed, so numbering starts at 1.
+    uint64_t m_Frame = 1;
+    uint64_t m_CompletedFrame = 0;
+    GLResourceStats m_Stats;
+};
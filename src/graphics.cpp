@@ -5,55 +5,258 @@
 #include <stb_image.h>
 
 
+// Buffer targets whose bindings are cached.
+static const unsigned int CachedBufferTargets[] = {
+    GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_COPY_READ_BUFFER,
+    GL_COPY_WRITE_BUFFER, GL_DRAW_INDIRECT_BUFFER, GL_UNIFORM_BUFFER,
+};
+static const int CachedBufferTargetCount = sizeof(CachedBufferTargets) / sizeof(CachedBufferTargets[0]);
+static const int ElementArraySlot = 1;
+static const int CachedTextureUnits = 16;
+
+// Never a valid name or enum, so the next call always goes through.
+static const unsigned int Unknown = ~0u;
+
+struct GLStateCache
+{
+    unsigned int Program;
+    unsigned int VertexArray;
+    unsigned int Buffers[CachedBufferTargetCount];
+    unsigned int ActiveTexture;
+    unsigned int Textures[CachedTextureUnits];
+    unsigned int PolygonMode;
+
+    GLStateStats Frame;
+    GLStateStats LastFrame;
+
+    GLStateCache() { Invalidate(); }
+
+    void Invalidate()
+    {
+        Program = Unknown;
+        VertexArray = Unknown;
+        for(unsigned int& buffer : Buffers)
+            buffer = Unknown;
+        ActiveTexture = Unknown;
+        for(unsigned int& texture : Textures)
+            texture = Unknown;
+        PolygonMode = Unknown;
+    }
+
+    // Returns whether the call has to be issued, updating the cached value.
+    bool Update(unsigned int& cached, unsigned int value, GLStateCall call)
+    {
+        if(cached == value)
+        {
+            ++Frame.Skipped[(int)call];
+            return false;
+        }
+        cached = value;
+        ++Frame.Issued[(int)call];
+        return true;
+    }
+};
+
+static GLStateCache s_State;
+
+static int BufferSlot(unsigned int target)
+{
+    for(int i = 0; i < CachedBufferTargetCount; ++i)
+    {
+        if(CachedBufferTargets[i] == target)
+            return i;
+    }
+    return -1;
+}
+
+
+void BeginGLStateFrame()
+{
+    s_State.LastFrame = s_State.Frame;
+    s_State.Frame = GLStateStats();
+}
+
+const GLStateStats& LastFrameGLStateStats()
+{
+    return s_State.LastFrame;
+}
+
+void InvalidateGLStateCache()
+{
+    s_State.Invalidate();
+}
+
+void BindBuffer(unsigned int target, unsigned int buffer)
+{
+    int slot = BufferSlot(target);
+    if(slot < 0)
+    {
+        ++s_State.Frame.Issued[(int)GLStateCall::BUFFER];
+        glBindBuffer(target, buffer);
+        return;
+    }
+
+    if(s_State.Update(s_State.Buffers[slot], buffer, GLStateCall::BUFFER))
+        glBindBuffer(target, buffer);
+}
+
+void BindTexture(unsigned int unit, unsigned int texture)
+{
+    if(s_State.Update(s_State.ActiveTexture, unit, GLStateCall::TEXTURE))
+        glActiveTexture(GL_TEXTURE0 + unit);
+
+    if(unit >= CachedTextureUnits)
+    {
+        ++s_State.Frame.Issued[(int)GLStateCall::TEXTURE];
+        glBindTexture(GL_TEXTURE_2D, texture);
+        return;
+    }
+
+    if(s_State.Update(s_State.Textures[unit], texture, GLStateCall::TEXTURE))
+        glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void SetPolygonMode(unsigned int mode)
+{
+    if(s_State.Update(s_State.PolygonMode, mode, GLStateCall::POLYGON_MODE))
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+}
+
+
+
+void BindShader(unsigned int shader)
+{
+    if(s_State.Update(s_State.Program, shader, GLStateCall::PROGRAM))
+        glUseProgram(shader);
+}
+
+void DeleteShader(unsigned int shader)
+{
+    // A program in use is only flagged for deletion, but its name must not
+    // be trusted in the cache any more.
+    if(s_State.Program == shader)
+        s_State.Program = Unknown;
+    glDeleteProgram(shader);
+}
+
+
 
 unsigned int CreateVertexArray()
 {
     unsigned int va;
     glGenVertexArrays(1, &va);
-    glBindVertexArray(va);
+    BindVertexArray(va);
     return va;
 }
 
 void BindVertexArray(unsigned int vao)
 {
-    glBindVertexArray(vao);
+    if(s_State.Update(s_State.VertexArray, vao, GLStateCall::VERTEX_ARRAY))
+    {
+        glBindVertexArray(vao);
+        s_State.Buffers[ElementArraySlot] = Unknown;
+    }
 }
 
 void AddVertexAttrib(unsigned int vao, int index, VertexAttribType type, unsigned int count,
                      unsigned int stride, unsigned int offset)
 {
-    glBindVertexArray(vao);
+    BindVertexArray(vao);
     glVertexAttribPointer(index, count, (unsigned int)type, GL_FALSE, stride, (void*)(uintptr_t)offset);
     glEnableVertexAttribArray(index);
 }
 
+void AddVertexAttribInt(unsigned int vao, int index, VertexAttribType type, unsigned int count,
+                        unsigned int stride, unsigned int offset)
+{
+    BindVertexArray(vao);
+    glVertexAttribIPointer(index, count, (unsigned int)type, stride, (void*)(uintptr_t)offset);
+    glEnableVertexAttribArray(index);
+}
+
 
 unsigned int CreateVertexBuffer(void* data, unsigned int size)
 {
     unsigned int vbo;
     glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    BindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
     return vbo;
 }
 
 void BindVertexBuffer(unsigned int vbo)
 {
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    BindBuffer(GL_ARRAY_BUFFER, vbo);
 }
 
 unsigned int CreateIndexBuffer(void* data, unsigned int size)
 {
     unsigned int ibo;
     glGenBuffers(1, &ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
     return ibo;
 }
 
 void BindIndexBuffer(unsigned int ibo)
 {
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+}
+
+unsigned int CreateUniformBuffer(unsigned int size)
+{
+    unsigned int ubo;
+    glGenBuffers(1, &ubo);
+    BindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    return ubo;
+}
+
+void BindUniformBuffer(unsigned int binding, unsigned int ubo)
+{
+    // Also binds the generic GL_UNIFORM_BUFFER target.
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, ubo);
+    s_State.Buffers[BufferSlot(GL_UNIFORM_BUFFER)] = ubo;
+}
+
+void UpdateUniformBuffer(unsigned int ubo, const void* data, unsigned int size)
+{
+    BindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+}
+
+
+
+// Deleting an object unbinds it, and its name may be handed out again, so
+// the cache forgets it.
+void DeleteVertexArray(unsigned int vao)
+{
+    if(s_State.VertexArray == vao)
+        s_State.VertexArray = Unknown;
+    glDeleteVertexArrays(1, &vao);
+}
+
+void DeleteBuffer(unsigned int buffer)
+{
+    for(unsigned int& bound : s_State.Buffers)
+    {
+        if(bound == buffer)
+            bound = Unknown;
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+void DeleteTexture(unsigned int texture)
+{
+    if(!texture)
+        return;
+
+    for(unsigned int& bound : s_State.Textures)
+    {
+        if(bound == texture)
+            bound = Unknown;
+    }
+    glDeleteTextures(1, &texture);
 }
 
 unsigned int SizeOfType(VertexAttribType type)
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include <glm/glm.hpp>
 #include <glad/gl.h>
 
@@ -23,8 +26,56 @@ enum class TextureType
     HEIGHT,
 };
 
-unsigned int CreateShader(const char* vertFile, const char* fragFile);
+// The bind and set functions below go through a cache of the current GL
+// state and skip the call when nothing would change. State changed behind
+// their back (other than by ImGui, which restores what it changes) needs an
+// InvalidateGLStateCache. Main thread only.
+enum class GLStateCall : uint8_t
+{
+    PROGRAM = 0,
+    VERTEX_ARRAY,
+    BUFFER,
+    TEXTURE,
+    POLYGON_MODE,
+};
+static constexpr int GLStateCallCount = 5;
+
+inline const char* GLStateCallName(GLStateCall call)
+{
+    switch(call)
+    {
+        case GLStateCall::PROGRAM: return "Program";
+        case GLStateCall::VERTEX_ARRAY: return "Vertex array";
+        case GLStateCall::BUFFER: return "Buffer";
+        case GLStateCall::TEXTURE: return "Texture";
+        case GLStateCall::POLYGON_MODE: return "Polygon mode";
+        default: return "Unknown";
+    }
+}
+
+struct GLStateStats
+{
+    size_t Issued[GLStateCallCount] = {};
+    size_t Skipped[GLStateCallCount] = {};
+};
+
+// Starts counting calls for a new frame.
+void BeginGLStateFrame();
+// Counts of the frame before the current one.
+const GLStateStats& LastFrameGLStateStats();
+void InvalidateGLStateCache();
+
+// Buffer bindings to GL_ELEMENT_ARRAY_BUFFER are vertex array state, so they
+// are only cached until the next vertex array bind.
+void BindBuffer(unsigned int target, unsigned int buffer);
+// Makes unit the active texture unit and binds a 2D texture to it.
+void BindTexture(unsigned int unit, unsigned int texture);
+void SetPolygonMode(unsigned int mode);
+
+
+
 void BindShader(unsigned int shader);
+void DeleteShader(unsigned int shader);
 
 
 
@@ -32,6 +83,9 @@ unsigned int CreateVertexArray();
 void BindVertexArray(unsigned int vao);
 void AddVertexAttrib(unsigned int vao, int index, VertexAttribType type, unsigned int count,
                      unsigned int stride, unsigned int offset);
+// Integer attribute, read by the shader without conversion to float.
+void AddVertexAttribInt(unsigned int vao, int index, VertexAttribType type, unsigned int count,
+                        unsigned int stride, unsigned int offset);
 
 
 
@@ -45,3 +99,60 @@ void BindIndexBuffer(unsigned int ibo);
 
 
 
+unsigned int CreateUniformBuffer(unsigned int size);
+// Binds the buffer to a uniform block binding point for every program.
+void BindUniformBuffer(unsigned int binding, unsigned int ubo);
+void UpdateUniformBuffer(unsigned int ubo, const void* data, unsigned int size);
+
+
+
+void DeleteVertexArray(unsigned int vao);
+void DeleteBuffer(unsigned int buffer);
+void DeleteTexture(unsigned int texture);
+
+// Owns one GL object name and deletes it when destroyed or reset. Move-only,
+// so a copy can never delete the same name twice.
+template<void (*Delete)(unsigned int)>
+class GLHandle
+{
+public:
+    GLHandle() = default;
+    explicit GLHandle(unsigned int id) : m_Id(id) {}
+
+    GLHandle(const GLHandle&) = delete;
+    GLHandle& operator=(const GLHandle&) = delete;
+
+    GLHandle(GLHandle&& other) noexcept
+        : m_Id(other.m_Id)
+    {
+        other.m_Id = 0;
+    }
+
+    GLHandle& operator=(GLHandle&& other) noexcept
+    {
+        if(this != &other)
+        {
+            Reset(other.m_Id);
+            other.m_Id = 0;
+        }
+        return *this;
+    }
+
+    ~GLHandle() { Reset(); }
+
+    void Reset(unsigned int id = 0)
+    {
+        if(m_Id)
+            Delete(m_Id);
+        m_Id = id;
+    }
+
+    unsigned int Get() const { return m_Id; }
+    explicit operator bool() const { return m_Id != 0; }
+
+private:
+    unsigned int m_Id = 0;
+};
+
+using VertexArrayHandle = GLHandle<DeleteVertexArray>;
+using BufferHandle = GLHandle<DeleteBuffer>;
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "chunkMap.hpp"
+
+
+// One chunk's heights inside a larger row-major grid. Doesn't own the data.
+struct HeightmapView
+{
+    const float* Data = nullptr;
+    // Distance between rows, in floats.
+    int Stride = 0;
+
+    float operator()(int x, int z) const { return Data[z * Stride + x]; }
+};
+
+// One chunk's worth of terrain heights. Doesn't own them either: tiles point
+// into the batch they were generated in, and the pointer the cache hands out
+// keeps that batch alive.
+struct HeightmapTile
+{
+    HeightmapView Heights;
+
+    HeightmapView View() const { return Heights; }
+};
+
+struct HeightmapCacheStats
+{
+    size_t Hits = 0;
+    size_t Misses = 0;
+    size_t Evictions = 0;
+    // Times the cache was emptied because the noise parameters changed.
+    size_t Invalidations = 0;
+
+    float HitRate() const { return Hits + Misses ? (float)Hits / (Hits + Misses) : 0.0f; }
+};
+
+// Bounded LRU cache of heightmap tiles keyed by tile coordinate. Every entry
+// was generated with the same noise parameters, identified by a hash: a
+// lookup with another hash misses, and an insert with one empties the cache
+// first. Tiles are shared, so a tile evicted while someone still reads it
+// stays alive until they let go. Safe to use from any thread.
+class HeightmapCache
+{
+public:
+    using TilePtr = std::shared_ptr<const HeightmapTile>;
+
+    HeightmapCache(size_t capacityTiles)
+        : m_CapacityTiles(capacityTiles)
+    {}
+
+    TilePtr Find(uint64_t params, int32_t x, int32_t y)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        const int* slot = params == m_Params ? m_Index.Find(x, y) : nullptr;
+        if(!slot)
+        {
+            ++m_Stats.Misses;
+            return nullptr;
+        }
+
+        ++m_Stats.Hits;
+        Unlink(*slot);
+        LinkFront(*slot);
+        return m_Entries[*slot].Tile;
+    }
+
+    void Insert(uint64_t params, int32_t x, int32_t y, TilePtr tile)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        if(params != m_Params)
+        {
+            if(m_Index.Size() > 0)
+                ++m_Stats.Invalidations;
+            ClearLocked();
+            m_Params = params;
+        }
+        if(m_CapacityTiles == 0)
+            return;
+
+        // Two workers may generate the same tile; the samples are identical,
+        // so the first one wins.
+        if(m_Index.Find(x, y))
+            return;
+
+        if(m_Index.Size() >= m_CapacityTiles)
+        {
+            ++m_Stats.Evictions;
+            Remove(m_Tail);
+        }
+
+        int slot;
+        if(m_FreeSlots.empty())
+        {
+            slot = (int)m_Entries.size();
+            m_Entries.emplace_back();
+        }
+        else
+        {
+            slot = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+        }
+
+        Entry& entry = m_Entries[slot];
+        entry.Tile = std::move(tile);
+        entry.X = x;
+        entry.Y = y;
+        m_Index.Insert(x, y, slot);
+        LinkFront(slot);
+    }
+
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        if(m_Index.Size() > 0)
+            ++m_Stats.Invalidations;
+        ClearLocked();
+    }
+
+    size_t Count() const
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        return m_Index.Size();
+    }
+
+    size_t CapacityTiles() const { return m_CapacityTiles; }
+
+    HeightmapCacheStats Stats() const
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        return m_Stats;
+    }
+
+    void ResetStats()
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Stats = HeightmapCacheStats();
+    }
+
+private:
+    struct Entry
+    {
+        TilePtr Tile;
+        int32_t X = 0;
+        int32_t Y = 0;
+        // Neighbors in the recency list, most recent first.
+        int Prev = -1;
+        int Next = -1;
+    };
+
+    void ClearLocked()
+    {
+        while(m_Tail >= 0)
+            Remove(m_Tail);
+    }
+
+    void Remove(int slot)
+    {
+        Entry& entry = m_Entries[slot];
+        Unlink(slot);
+        m_Index.Erase(entry.X, entry.Y);
+        entry.Tile.reset();
+        m_FreeSlots.push_back(slot);
+    }
+
+    void LinkFront(int slot)
+    {
+        Entry& entry = m_Entries[slot];
+        entry.Prev = -1;
+        entry.Next = m_Head;
+        if(m_Head >= 0)
+            m_Entries[m_Head].Prev = slot;
+        m_Head = slot;
+        if(m_Tail < 0)
+            m_Tail = slot;
+    }
+
+    void Unlink(int slot)
+    {
+        Entry& entry = m_Entries[slot];
+        if(entry.Prev >= 0)
+            m_Entries[entry.Prev].Next = entry.Next;
+        else
+            m_Head = entry.Next;
+
+        if(entry.Next >= 0)
+            m_Entries[entry.Next].Prev = entry.Prev;
+        else
+            m_Tail = entry.Prev;
+
+        entry.Prev = -1;
+        entry.Next = -1;
+    }
+
+private:
+    mutable std::mutex m_Lock;
+    std::vector<Entry> m_Entries;
+    std::vector<int> m_FreeSlots;
+    ChunkMap<int> m_Index;
+    int m_Head = -1;
+    int m_Tail = -1;
+
+    size_t m_CapacityTiles;
+    uint64_t m_Params = 0;
+    HeightmapCacheStats m_Stats;
+};
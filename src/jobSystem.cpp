@@ -0,0 +1,153 @@
+#include "jobSystem.hpp"
+
+
+// Index of the worker owning the current thread, -1 on non-worker threads.
+static thread_local int t_WorkerIndex = -1;
+
+
+JobSystem::JobSystem(unsigned int workerCount)
+{
+    if(workerCount == 0)
+    {
+        unsigned int hwThreads = std::thread::hardware_concurrency();
+        workerCount = hwThreads > 1 ? hwThreads - 1 : 1;
+    }
+
+    m_Workers.reserve(workerCount);
+    for(unsigned int i = 0; i < workerCount; ++i)
+    {
+        m_Workers.push_back(std::make_unique<Worker>());
+    }
+
+    for(unsigned int i = 0; i < workerCount; ++i)
+    {
+        m_Workers[i]->Thread = std::thread(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    WaitIdle();
+
+    {
+        std::lock_guard<std::mutex> lock(m_SleepLock);
+        m_Running = false;
+    }
+    m_WakeCondition.notify_all();
+
+    for(auto& worker : m_Workers)
+    {
+        worker->Thread.join();
+    }
+}
+
+void JobSystem::Submit(Job job)
+{
+    unsigned int target = t_WorkerIndex >= 0
+        ? (unsigned int)t_WorkerIndex
+        : m_NextWorker.fetch_add(1, std::memory_order_relaxed) % m_Workers.size();
+
+    // Counters go up before the job is visible so they never underflow when
+    // another thread pops it straight away.
+    m_Unfinished.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_SleepLock);
+        m_Queued.fetch_add(1, std::memory_order_release);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Workers[target]->Lock);
+        m_Workers[target]->Jobs.push_back(std::move(job));
+    }
+    m_WakeCondition.notify_one();
+}
+
+void JobSystem::WaitIdle()
+{
+    Job job;
+    while(!Idle())
+    {
+        if(FindJob(t_WorkerIndex, job))
+        {
+            job();
+            job = nullptr;
+            if(m_Unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                std::lock_guard<std::mutex> lock(m_SleepLock);
+                m_IdleCondition.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_SleepLock);
+        m_IdleCondition.wait(lock, [this] {
+            return Idle() || m_Queued.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
+
+void JobSystem::WorkerLoop(unsigned int index)
+{
+    t_WorkerIndex = (int)index;
+
+    Job job;
+    for(;;)
+    {
+        if(FindJob((int)index, job))
+        {
+            job();
+            job = nullptr;
+            if(m_Unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                std::lock_guard<std::mutex> lock(m_SleepLock);
+                m_IdleCondition.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_SleepLock);
+        m_WakeCondition.wait(lock, [this] {
+            return !m_Running || m_Queued.load(std::memory_order_acquire) > 0;
+        });
+        if(!m_Running && m_Queued.load(std::memory_order_acquire) == 0)
+            return;
+    }
+}
+
+bool JobSystem::FindJob(int index, Job& job)
+{
+    if(index >= 0 && PopLocal((unsigned int)index, job))
+        return true;
+    return Steal(index >= 0 ? (unsigned int)index : 0, job);
+}
+
+bool JobSystem::PopLocal(unsigned int index, Job& job)
+{
+    Worker& worker = *m_Workers[index];
+    std::lock_guard<std::mutex> lock(worker.Lock);
+    if(worker.Jobs.empty())
+        return false;
+
+    job = std::move(worker.Jobs.back());
+    worker.Jobs.pop_back();
+    m_Queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool JobSystem::Steal(unsigned int thief, Job& job)
+{
+    const unsigned int count = (unsigned int)m_Workers.size();
+    for(unsigned int i = 1; i <= count; ++i)
+    {
+        Worker& victim = *m_Workers[(thief + i) % count];
+        std::unique_lock<std::mutex> lock(victim.Lock, std::try_to_lock);
+        if(!lock.owns_lock() || victim.Jobs.empty())
+            continue;
+
+        job = std::move(victim.Jobs.front());
+        victim.Jobs.pop_front();
+        m_Queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
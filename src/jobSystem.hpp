@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Fixed pool of worker threads, each owning a deque of jobs. A worker pops
+// its own newest job first and, when its deque runs dry, steals the oldest
+// job from another worker. Jobs submitted from outside the pool are spread
+// round-robin across the workers.
+class JobSystem
+{
+public:
+    using Job = std::function<void()>;
+
+    // workerCount == 0 uses every hardware thread except the calling one.
+    JobSystem(unsigned int workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void Submit(Job job);
+
+    // Blocks until every submitted job has finished. The calling thread
+    // helps run queued jobs while it waits.
+    void WaitIdle();
+
+    bool Idle() const { return m_Unfinished.load(std::memory_order_acquire) == 0; }
+    unsigned int WorkerCount() const { return (unsigned int)m_Workers.size(); }
+
+private:
+    struct Worker
+    {
+        std::mutex Lock;
+        std::deque<Job> Jobs;
+        std::thread Thread;
+    };
+
+    void WorkerLoop(unsigned int index);
+    bool PopLocal(unsigned int index, Job& job);
+    bool Steal(unsigned int thief, Job& job);
+    bool FindJob(int index, Job& job);
+
+private:
+    std::vector<std::unique_ptr<Worker>> m_Workers;
+
+    std::atomic<size_t> m_Queued = 0;
+    std::atomic<size_t> m_Unfinished = 0;
+    std::atomic<unsigned int> m_NextWorker = 0;
+    std::atomic<bool> m_Running = true;
+
+    std::mutex m_SleepLock;
+    std::condition_variable m_WakeCondition;
+    std::condition_variable m_IdleCondition;
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "blockLayout.hpp"
+#include "chunk.hpp"
+#include "mesher.hpp"
+#include "noise.hpp"
+#include "perfCounter.hpp"
+#include "terrainFill.hpp"
+#include "util.hpp"
+
+
+struct BlockLayoutStats
+{
+    // Per chunk.
+    double FillMs = 0.0;
+    double MeshMs = 0.0;
+    double QueryMs = 0.0;
+    // L1 data cache read misses per chunk, when the counter is available.
+    double FillMisses = 0.0;
+    double MeshMisses = 0.0;
+    double QueryMisses = 0.0;
+    size_t BlockBytes = 0;
+    // Faces found by the query sweep. Equal for every layout, since they
+    // all hold the same blocks.
+    size_t QueryFaces = 0;
+};
+
+struct BlockLayoutBenchmark
+{
+    std::array<BlockLayoutStats, BlockLayoutCount> Layouts;
+    bool CountsMisses = false;
+};
+
+// Reads every block with GetBlock along with its six neighbors, the access
+// pattern of per-voxel code like the naive and greedy meshers. Returns the
+// faces between a block and air.
+template<int Size, int Height, typename Layout>
+inline size_t CountExposedFaces(const BasicChunk<Size, Height, Layout>& chunk)
+{
+    size_t faces = 0;
+    for(int x = 1; x < Size - 1; ++x)
+    {
+        for(int y = 1; y < Height - 1; ++y)
+        {
+            for(int z = 1; z < Size - 1; ++z)
+            {
+                if(chunk.GetBlock(x, y, z) == BlockType::AIR)
+                    continue;
+
+                faces += (chunk.GetBlock(x - 1, y, z) == BlockType::AIR) + (chunk.GetBlock(x + 1, y, z) == BlockType::AIR) +
+                         (chunk.GetBlock(x, y - 1, z) == BlockType::AIR) + (chunk.GetBlock(x, y + 1, z) == BlockType::AIR) +
+                         (chunk.GetBlock(x, y, z - 1) == BlockType::AIR) + (chunk.GetBlock(x, y, z + 1) == BlockType::AIR);
+            }
+        }
+    }
+    return faces;
+}
+
+// Fills, meshes with the binary mesher, and sweeps the blocks of one chunk
+// per heightmap, stored in Layout. Each step runs once untimed first.
+template<typename Layout>
+inline BlockLayoutStats MeasureBlockLayout(const std::vector<std::vector<float>>& heightMaps, int stride, CacheMissCounter& misses)
+{
+    const int count = (int)heightMaps.size();
+    using LayoutChunk = BasicChunk<ChunkSize, ChunkHeight, Layout>;
+    std::vector<std::unique_ptr<LayoutChunk>> chunks(count);
+    for(int c = 0; c < count; ++c)
+    {
+        chunks[c] = std::make_unique<LayoutChunk>();
+        FillChunkBlocks(*chunks[c], { heightMaps[c].data(), stride });
+    }
+
+    BlockLayoutStats stats;
+    auto measure = [&](auto&& step, double& ms, double& missCount) {
+        for(int c = 0; c < count; ++c)
+            step(c);
+
+        Timer timer;
+        misses.Start();
+        for(int c = 0; c < count; ++c)
+            step(c);
+        missCount = (double)misses.Stop() / count;
+        ms = timer.ElapsedMilli() / count;
+    };
+
+    measure([&](int c) { FillChunkBlocks(*chunks[c], { heightMaps[c].data(), stride }); }, stats.FillMs, stats.FillMisses);
+
+    ChunkMesh mesh;
+    measure([&](int c) { GenerateChunkMeshBinary(*chunks[c], mesh); }, stats.MeshMs, stats.MeshMisses);
+
+    size_t faces = 0;
+    measure([&](int c) { faces += CountExposedFaces(*chunks[c]); }, stats.QueryMs, stats.QueryMisses);
+    stats.QueryFaces = faces / (2 * count);
+
+    for(const auto& chunk : chunks)
+        stats.BlockBytes += chunk->BlockMemoryUsage();
+    stats.BlockBytes /= count;
+    return stats;
+}
+
+// Runs MeasureBlockLayout for every layout on the same chunks.
+inline BlockLayoutBenchmark MeasureBlockLayouts(const NoiseGen& noise, int featureSize, int chunks)
+{
+    std::vector<std::vector<float>> heightMaps(chunks);
+    for(int c = 0; c < chunks; ++c)
+    {
+        heightMaps[c] = noise.GenerateNoise2D(c, 0, featureSize);
+    }
+
+    BlockLayoutBenchmark benchmark;
+    CacheMissCounter misses;
+    benchmark.CountsMisses = misses.Valid();
+    for(int layout = 0; layout < BlockLayoutCount; ++layout)
+    {
+        benchmark.Layouts[layout] = VisitBlockLayout<ChunkSize, SectionHeight>((BlockLayout)layout, [&](auto policy) {
+            return MeasureBlockLayout<decltype(policy)>(heightMaps, noise.Width(), misses);
+        });
+    }
+    return benchmark;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+
+// Bounded multi-producer/multi-consumer queue (Vyukov). Every slot carries a
+// sequence number so producers and consumers only ever contend on a single
+// atomic cursor each and never take a lock. Capacity must be a power of two.
+template<typename T, size_t Capacity>
+class LockFreeQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    LockFreeQueue()
+        : m_Slots(std::make_unique<Slot[]>(Capacity))
+    {
+        for(size_t i = 0; i < Capacity; ++i)
+        {
+            m_Slots[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    // Returns false if the queue is full.
+    bool TryPush(const T& value)
+    {
+        size_t pos = m_Tail.load(std::memory_order_relaxed);
+        Slot* slot;
+        for(;;)
+        {
+            slot = &m_Slots[pos & (Capacity - 1)];
+            size_t seq = slot->Sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if(diff == 0)
+            {
+                if(m_Tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if(diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = m_Tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->Value = value;
+        slot->Sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns false if the queue is empty.
+    bool TryPop(T& out)
+    {
+        size_t pos = m_Head.load(std::memory_order_relaxed);
+        Slot* slot;
+        for(;;)
+        {
+            slot = &m_Slots[pos & (Capacity - 1)];
+            size_t seq = slot->Sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if(diff == 0)
+            {
+                if(m_Head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if(diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = m_Head.load(std::memory_order_relaxed);
+            }
+        }
+
+        out = slot->Value;
+        slot->Sequence.store(pos + Capacity, std::memory_order_release);
+        return true;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> Sequence;
+        T Value;
+    };
+
+    static constexpr size_t CacheLine = 64;
+
+    std::unique_ptr<Slot[]> m_Slots;
+    alignas(CacheLine) std::atomic<size_t> m_Head = 0;
+    alignas(CacheLine) std::atomic<size_t> m_Tail = 0;
+};
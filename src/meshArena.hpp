@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <glad/gl.h>
+#include "glResourceManager.hpp"
+
+
+class MeshArena;
+
+// A range of elements in a MeshArena. Hands the range back to the arena when
+// destroyed or reset. Move-only, like GLHandle.
+class MeshAllocation
+{
+public:
+    MeshAllocation() = default;
+    MeshAllocation(MeshArena* arena, uint32_t offset, uint32_t count)
+        : m_Arena(arena), m_Offset(offset), m_Count(count)
+    {}
+
+    MeshAllocation(const MeshAllocation&) = delete;
+    MeshAllocation& operator=(const MeshAllocation&) = delete;
+
+    MeshAllocation(MeshAllocation&& other) noexcept
+        : m_Arena(other.m_Arena), m_Offset(other.m_Offset), m_Count(other.m_Count)
+    {
+        other.m_Arena = nullptr;
+        other.m_Count = 0;
+    }
+
+    MeshAllocation& operator=(MeshAllocation&& other) noexcept
+    {
+        if(this != &other)
+        {
+            Reset();
+            m_Arena = other.m_Arena;
+            m_Offset = other.m_Offset;
+            m_Count = other.m_Count;
+            other.m_Arena = nullptr;
+            other.m_Count = 0;
+        }
+        return *this;
+    }
+
+    ~MeshAllocation() { Reset(); }
+
+    inline void Reset();
+
+    uint32_t Offset() const { return m_Offset; }
+    uint32_t Count() const { return m_Count; }
+    explicit operator bool() const { return m_Count != 0; }
+
+private:
+    MeshArena* m_Arena = nullptr;
+    uint32_t m_Offset = 0;
+    uint32_t m_Count = 0;
+};
+
+// One GL buffer that every chunk mesh is sub-allocated from, in elements of a
+// fixed size. Free ranges sit in a list sorted by offset; allocation takes
+// the first range that fits, and freed ranges merge with their neighbors so
+// the list stays short. When nothing fits, the buffer doubles and its
+// contents are copied over on the GPU. A freed range may still be drawn
+// from by frames in flight, so it is only reused once the frame it was
+// freed in has completed; until then it counts as retired. Main thread only.
+class MeshArena
+{
+public:
+    MeshArena(GLResourceManager& resources, uint32_t elementSize, uint32_t initialCapacity)
+        : m_Resources(resources), m_ElementSize(elementSize), m_InitialCapacity(initialCapacity)
+    {}
+
+    ~MeshArena()
+    {
+        m_Resources.ReleaseBuffer(m_Buffer);
+    }
+
+    MeshArena(const MeshArena&) = delete;
+    MeshArena& operator=(const MeshArena&) = delete;
+
+    // An empty allocation for count 0.
+    MeshAllocation Allocate(uint32_t count)
+    {
+        if(count == 0)
+            return MeshAllocation();
+
+        ReclaimRetired();
+        for(;;)
+        {
+            for(size_t i = 0; i < m_Free.size(); ++i)
+            {
+                FreeRange& range = m_Free[i];
+                if(range.Count < count)
+                    continue;
+
+                const uint32_t offset = range.Offset;
+                range.Offset += count;
+                range.Count -= count;
+                if(range.Count == 0)
+                    m_Free.erase(m_Free.begin() + i);
+                m_Used += count;
+                return MeshAllocation(this, offset, count);
+            }
+
+            Grow(std::max(m_Capacity ? m_Capacity * 2 : m_InitialCapacity, m_Capacity + count));
+        }
+    }
+
+    // Copies count elements of data into the allocation.
+    void Upload(const MeshAllocation& allocation, const void* data)
+    {
+        if(!allocation)
+            return;
+
+        BindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer.Id);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)allocation.Offset() * m_ElementSize,
+                        (GLsizeiptr)allocation.Count() * m_ElementSize, data);
+    }
+
+    // Copies the allocation's contents from another buffer on the GPU.
+    void CopyFrom(unsigned int source, size_t sourceOffset, const MeshAllocation& allocation)
+    {
+        if(!allocation)
+            return;
+
+        BindBuffer(GL_COPY_READ_BUFFER, source);
+        BindBuffer(GL_COPY_WRITE_BUFFER, m_Buffer.Id);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)sourceOffset,
+                            (GLintptr)allocation.Offset() * m_ElementSize, (GLsizeiptr)allocation.Count() * m_ElementSize);
+    }
+
+    unsigned int Buffer() const { return m_Buffer.Id; }
+    // Changes whenever Buffer() is replaced, so vertex arrays know to rebind it.
+    uint32_t Generation() const { return m_Generation; }
+
+    uint32_t ElementSize() const { return m_ElementSize; }
+    uint32_t Capacity() const { return m_Capacity; }
+    uint32_t Used() const { return m_Used; }
+    // Freed elements waiting for their frame to complete.
+    uint32_t Retired() const { return m_Retired; }
+    size_t FreeRanges() const { return m_Free.size(); }
+
+private:
+    friend class MeshAllocation;
+
+    struct FreeRange
+    {
+        uint32_t Offset;
+        uint32_t Count;
+    };
+
+    struct RetiredRange
+    {
+        uint32_t Offset;
+        uint32_t Count;
+        uint64_t Frame;
+    };
+
+    void Free(uint32_t offset, uint32_t count)
+    {
+        m_Used -= count;
+        m_Retired += count;
+        m_RetiredRanges.push_back({ offset, count, m_Resources.Frame() });
+    }
+
+    void ReclaimRetired()
+    {
+        while(!m_RetiredRanges.empty() && m_Resources.FrameCompleted(m_RetiredRanges.front().Frame))
+        {
+            const RetiredRange& range = m_RetiredRanges.front();
+            m_Retired -= range.Count;
+            InsertFree(range.Offset, range.Count);
+            m_RetiredRanges.pop_front();
+        }
+    }
+
+    void InsertFree(uint32_t offset, uint32_t count)
+    {
+        auto next = std::lower_bound(m_Free.begin(), m_Free.end(), offset,
+                                     [](const FreeRange& range, uint32_t value) { return range.Offset < value; });
+        const bool mergePrev = next != m_Free.begin() && (next - 1)->Offset + (next - 1)->Count == offset;
+        const bool mergeNext = next != m_Free.end() && offset + count == next->Offset;
+
+        if(mergePrev && mergeNext)
+        {
+            (next - 1)->Count += count + next->Count;
+            m_Free.erase(next);
+        }
+        else if(mergePrev)
+            (next - 1)->Count += count;
+        else if(mergeNext)
+        {
+            next->Offset = offset;
+            next->Count += count;
+        }
+        else
+            m_Free.insert(next, { offset, count });
+    }
+
+    // The old buffer goes back to the resource manager, which holds on to it
+    // until the frames drawing from it are done.
+    void Grow(uint32_t capacity)
+    {
+        PooledBuffer buffer = m_Resources.AcquireBuffer((size_t)capacity * m_ElementSize, BufferUsage::STATIC);
+        capacity = (uint32_t)(buffer.Bytes / m_ElementSize);
+        if(m_Buffer)
+        {
+            BindBuffer(GL_COPY_READ_BUFFER, m_Buffer.Id);
+            BindBuffer(GL_COPY_WRITE_BUFFER, buffer.Id);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)m_Capacity * m_ElementSize);
+            m_Resources.ReleaseBuffer(m_Buffer);
+        }
+        m_Buffer = buffer;
+        ++m_Generation;
+
+        InsertFree(m_Capacity, capacity - m_Capacity);
+        m_Capacity = capacity;
+    }
+
+private:
+    GLResourceManager& m_Resources;
+    PooledBuffer m_Buffer;
+    uint32_t m_ElementSize;
+    uint32_t m_InitialCapacity;
+    uint32_t m_Capacity = 0;
+    uint32_t m_Used = 0;
+    uint32_t m_Generation = 0;
+    uint32_t m_Retired = 0;
+    std::vector<FreeRange> m_Free;
+    // In the order they were freed, so in frame order.
+    std::deque<RetiredRange> m_RetiredRanges;
+};
+
+inline void MeshAllocation::Reset()
+{
+    if(m_Arena && m_Count)
+        m_Arena->Free(m_Offset, m_Count);
+    m_Arena = nullptr;
+    m_Count = 0;
+}
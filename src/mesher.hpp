@@ -0,0 +1,715 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <memory>
+#include <vector>
+
+#include "allocCounter.hpp"
+#include "chunk.hpp"
+#include "util.hpp"
+
+
+enum class MeshMode : uint8_t
+{
+    NAIVE = 0,
+    GREEDY,
+    BINARY,
+};
+static const int MeshModeCount = 3;
+
+// Face ids stored in packed vertices: 2 * axis + (positive ? 1 : 0).
+inline int FaceId(int axis, bool positive)
+{
+    return axis * 2 + (positive ? 1 : 0);
+}
+
+inline void AddFace(std::vector<ChunkVertex>& vertices, int x, int y, int z, const int offsets[4][3], int face,
+                    BlockType type, const int texCoords[4][2])
+{
+    for(int i = 0; i < 4; ++i)
+    {
+        vertices.push_back(PackVertex(x + offsets[i][0], y + offsets[i][1], z + offsets[i][2], face, type,
+                                      texCoords[i][0], texCoords[i][1]));
+    }
+}
+
+// Per-thread buffers reused by every naive mesh, so meshing doesn't allocate
+// once a worker has meshed its first chunk.
+struct NaiveMeshScratch
+{
+    // Per block: bit f set when face id f is visible, block type in the high
+    // byte. Indexed [x][y][z].
+    std::vector<uint16_t> Faces;
+};
+
+// One quad per visible block face. The first pass finds visible faces and
+// counts them, the second writes them into buffers reserved to the exact size.
+template<int Size, int Height, typename Layout>
+inline void GenerateChunkMeshNaive(const BasicChunk<Size, Height, Layout>& chunk, ChunkMesh& mesh)
+{
+    static thread_local NaiveMeshScratch t_Scratch;
+    std::vector<uint16_t>& faces = t_Scratch.Faces;
+    faces.assign(BasicChunk<Size, Height, Layout>::BlockCount, 0);
+
+    size_t terrainFaces = 0;
+    size_t waterFaces = 0;
+    for (int x = 0; x < Size; ++x)
+    {
+        for (int y = 0; y < Height; ++y)
+        {
+            for (int z = 0; z < Size; ++z)
+            {
+                BlockType block = chunk.GetBlock(x, y, z);
+                if (block == BlockType::AIR) continue;
+
+                bool isWater = (block == BlockType::WATER);
+                bool visible[6] = {
+                    x == 0 ? chunk.EdgeFaceVisible(ChunkSide::NEG_X, y, z, block) : (chunk.GetBlock(x - 1, y, z) == BlockType::AIR || (isWater && chunk.GetBlock(x - 1, y, z) != BlockType::WATER)),
+                    x == Size - 1 ? chunk.EdgeFaceVisible(ChunkSide::POS_X, y, z, block) : (chunk.GetBlock(x + 1, y, z) == BlockType::AIR || (isWater && chunk.GetBlock(x + 1, y, z) != BlockType::WATER)),
+                    y == 0 || chunk.GetBlock(x, y - 1, z) == BlockType::AIR || (isWater && chunk.GetBlock(x, y - 1, z) != BlockType::WATER),
+                    y == Height - 1 || chunk.GetBlock(x, y + 1, z) == BlockType::AIR || (isWater && chunk.GetBlock(x, y + 1, z) != BlockType::WATER),
+                    z == 0 ? chunk.EdgeFaceVisible(ChunkSide::NEG_Z, y, x, block) : (chunk.GetBlock(x, y, z - 1) == BlockType::AIR || (isWater && chunk.GetBlock(x, y, z - 1) != BlockType::WATER)),
+                    z == Size - 1 ? chunk.EdgeFaceVisible(ChunkSide::POS_Z, y, x, block) : (chunk.GetBlock(x, y, z + 1) == BlockType::AIR || (isWater && chunk.GetBlock(x, y, z + 1) != BlockType::WATER)),
+                };
+
+                uint16_t mask = 0;
+                for (int face = 0; face < 6; ++face)
+                    mask |= (uint16_t)visible[face] << face;
+                if (!mask) continue;
+
+                faces[((size_t)x * Height + y) * Size + z] = mask | (uint16_t)((int)block << 8);
+                (isWater ? waterFaces : terrainFaces) += std::popcount((unsigned int)mask);
+            }
+        }
+    }
+
+    mesh.Clear();
+    mesh.Vertices.reserve(terrainFaces * 4);
+    mesh.WaterVertices.reserve(waterFaces * 4);
+
+    // Tile local texcoords, rotated per block the same way the atlas
+    // coordinates always were.
+    const int dirtTexCoords[4][2] = {
+        {1, 0}, {1, 1}, {0, 1}, {0, 0}
+    };
+    const int defaultTexCoords[4][2] = {
+        {0, 0}, {1, 0}, {1, 1}, {0, 1}
+    };
+
+    // Corner offsets of each face, in face id order.
+    const int faceOffsets[6][4][3] = {
+        { {0, 0, 0}, {0, 1, 0}, {0, 1, 1}, {0, 0, 1} },
+        { {1, 0, 0}, {1, 1, 0}, {1, 1, 1}, {1, 0, 1} },
+        { {0, 0, 0}, {1, 0, 0}, {1, 0, 1}, {0, 0, 1} },
+        { {0, 1, 0}, {1, 1, 0}, {1, 1, 1}, {0, 1, 1} },
+        { {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0} },
+        { {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1} },
+    };
+
+    for (int x = 0; x < Size; ++x)
+    {
+        for (int y = 0; y < Height; ++y)
+        {
+            for (int z = 0; z < Size; ++z)
+            {
+                const uint16_t entry = faces[((size_t)x * Height + y) * Size + z];
+                if (!entry) continue;
+
+                BlockType block = (BlockType)(entry >> 8);
+                const int (*texCoords)[2] = block == BlockType::DIRT ? dirtTexCoords : defaultTexCoords;
+                std::vector<ChunkVertex>& vertices = block == BlockType::WATER ? mesh.WaterVertices : mesh.Vertices;
+
+                for (int face = 0; face < 6; ++face)
+                {
+                    if (entry & (1 << face))
+                        AddFace(vertices, x, y, z, faceOffsets[face], face, block, texCoords);
+                }
+            }
+        }
+    }
+}
+
+inline bool FaceVisible(BlockType block, BlockType neighbor)
+{
+    return neighbor == BlockType::AIR || (block == BlockType::WATER && neighbor != BlockType::WATER);
+}
+
+// Visibility of an x or z face on the chunk wall, from the neighbor's border.
+template<int Size, int Height, typename Layout>
+inline bool EdgeFaceVisible(const BasicChunk<Size, Height, Layout>& chunk, int axis, bool positive, const int pos[3], BlockType block)
+{
+    if(axis == 0)
+        return chunk.EdgeFaceVisible(positive ? ChunkSide::POS_X : ChunkSide::NEG_X, pos[1], pos[2], block);
+    return chunk.EdgeFaceVisible(positive ? ChunkSide::POS_Z : ChunkSide::NEG_Z, pos[1], pos[0], block);
+}
+
+// Adds a w x h quad lying on the given face of the block at pos. w runs along
+// axis (axis + 1) % 3 and h along (axis + 2) % 3. Side faces map v to world y
+// and top/bottom faces map (u, v) to world (x, z).
+inline void AddQuad(ChunkMesh& mesh, BlockType type, int axis, bool positive, const int pos[3], int w, int h)
+{
+    const int uAxis = (axis + 1) % 3;
+    const int vAxis = (axis + 2) % 3;
+
+    int origin[3] = { pos[0], pos[1], pos[2] };
+    origin[axis] += positive ? 1 : 0;
+
+    int corners[4][3];
+    for(int i = 0; i < 4; ++i)
+    {
+        corners[i][0] = origin[0];
+        corners[i][1] = origin[1];
+        corners[i][2] = origin[2];
+    }
+    corners[1][uAxis] += w;
+    corners[2][uAxis] += w;
+    corners[2][vAxis] += h;
+    corners[3][vAxis] += h;
+
+    // Z faces have u along x and v along y already, the other axes have
+    // them swapped relative to the texture.
+    const bool zFace = axis == 2;
+    const int texCoords[4][2] = {
+        { 0, 0 }, { zFace ? w : 0, zFace ? 0 : w }, { zFace ? w : h, zFace ? h : w }, { zFace ? 0 : h, zFace ? h : 0 }
+    };
+
+    const int face = FaceId(axis, positive);
+
+    std::vector<ChunkVertex>& vertices = type == BlockType::WATER ? mesh.WaterVertices : mesh.Vertices;
+    for(int i = 0; i < 4; ++i)
+        vertices.push_back(PackVertex(corners[i][0], corners[i][1], corners[i][2], face, type, texCoords[i][0], texCoords[i][1]));
+}
+
+// A merged quad as collected by the greedy and binary meshers, which gather
+// all quads first so the mesh can be allocated at its exact size.
+struct MeshQuad
+{
+    uint16_t Pos[3];
+    uint16_t W;
+    uint16_t H;
+    uint8_t Axis;
+    bool Positive;
+    BlockType Type;
+};
+
+// Writes collected quads into the mesh, sized exactly up front.
+inline void EmitQuads(const std::vector<MeshQuad>& quads, size_t waterQuads, ChunkMesh& mesh)
+{
+    const size_t terrainQuads = quads.size() - waterQuads;
+
+    mesh.Clear();
+    mesh.Vertices.reserve(terrainQuads * 4);
+    mesh.WaterVertices.reserve(waterQuads * 4);
+
+    for(const auto& quad : quads)
+    {
+        const int pos[3] = { quad.Pos[0], quad.Pos[1], quad.Pos[2] };
+        AddQuad(mesh, quad.Type, quad.Axis, quad.Positive, pos, quad.W, quad.H);
+    }
+}
+
+struct GreedyMeshScratch
+{
+    std::vector<BlockType> Mask;
+    std::vector<MeshQuad> Quads;
+};
+
+// Merges coplanar visible faces of the same block type into larger quads.
+// Each slice of each axis is flattened into a mask of face types, then
+// rectangles are grown first along u and then along v.
+template<int Size, int Height, typename Layout>
+inline void GenerateChunkMeshGreedy(const BasicChunk<Size, Height, Layout>& chunk, ChunkMesh& mesh)
+{
+    static thread_local GreedyMeshScratch t_Scratch;
+    std::vector<BlockType>& mask = t_Scratch.Mask;
+    std::vector<MeshQuad>& quads = t_Scratch.Quads;
+    mask.resize(Size * Height);
+    quads.clear();
+    size_t waterQuads = 0;
+
+    const int dims[3] = { Size, Height, Size };
+
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        const int uAxis = (axis + 1) % 3;
+        const int vAxis = (axis + 2) % 3;
+        const int uSize = dims[uAxis];
+        const int vSize = dims[vAxis];
+
+        for(int side = 0; side < 2; ++side)
+        {
+            const bool positive = side == 1;
+
+            for(int slice = 0; slice < dims[axis]; ++slice)
+            {
+                const int neighborSlice = positive ? slice + 1 : slice - 1;
+                const bool edge = neighborSlice < 0 || neighborSlice >= dims[axis];
+
+                int pos[3];
+                pos[axis] = slice;
+                for(pos[vAxis] = 0; pos[vAxis] < vSize; ++pos[vAxis])
+                {
+                    for(pos[uAxis] = 0; pos[uAxis] < uSize; ++pos[uAxis])
+                    {
+                        BlockType block = chunk.GetBlock(pos[0], pos[1], pos[2]);
+                        BlockType face = BlockType::AIR;
+                        if(block != BlockType::AIR)
+                        {
+                            if(edge)
+                            {
+                                // Top and bottom of the chunk always show;
+                                // side walls depend on the neighbor's edge.
+                                if(axis == 1 || EdgeFaceVisible(chunk, axis, positive, pos, block))
+                                    face = block;
+                            }
+                            else
+                            {
+                                int n[3] = { pos[0], pos[1], pos[2] };
+                                n[axis] = neighborSlice;
+                                if(FaceVisible(block, chunk.GetBlock(n[0], n[1], n[2])))
+                                    face = block;
+                            }
+                        }
+                        mask[pos[vAxis] * uSize + pos[uAxis]] = face;
+                    }
+                }
+
+                for(int v = 0; v < vSize; ++v)
+                {
+                    for(int u = 0; u < uSize;)
+                    {
+                        BlockType type = mask[v * uSize + u];
+                        if(type == BlockType::AIR)
+                        {
+                            ++u;
+                            continue;
+                        }
+
+                        int w = 1;
+                        while(u + w < uSize && mask[v * uSize + u + w] == type)
+                            ++w;
+
+                        int h = 1;
+                        for(; v + h < vSize; ++h)
+                        {
+                            bool rowMatches = true;
+                            for(int k = 0; k < w; ++k)
+                            {
+                                if(mask[(v + h) * uSize + u + k] != type)
+                                {
+                                    rowMatches = false;
+                                    break;
+                                }
+                            }
+                            if(!rowMatches)
+                                break;
+                        }
+
+                        MeshQuad quad = { {}, (uint16_t)w, (uint16_t)h, (uint8_t)axis, positive, type };
+                        quad.Pos[axis] = (uint16_t)slice;
+                        quad.Pos[uAxis] = (uint16_t)u;
+                        quad.Pos[vAxis] = (uint16_t)v;
+                        quads.push_back(quad);
+                        waterQuads += type == BlockType::WATER ? 1 : 0;
+
+                        for(int j = 0; j < h; ++j)
+                        {
+                            for(int k = 0; k < w; ++k)
+                            {
+                                mask[(v + j) * uSize + u + k] = BlockType::AIR;
+                            }
+                        }
+                        u += w;
+                    }
+                }
+            }
+        }
+    }
+
+    EmitQuads(quads, waterQuads, mesh);
+}
+
+// Occupancy rows used by the binary mesher. Each row is one machine word with
+// a bit per block along z: Rows[slot][y + 1][x] has bit z set when the block at
+// (x, y, z) belongs to the slot. Slot 0 is "any non-air block", the rest hold
+// one block type each. The rows at y = -1 and y = Height stay empty so
+// vertical neighbors never need a bounds check. One set per chunk shape.
+template<int Size, int Height>
+struct BinaryMeshScratch
+{
+    static_assert(Size <= 64, "Binary mesher packs a chunk row into one 64-bit word");
+    static const int MaxSlots = 6;
+
+    std::array<std::array<std::array<uint64_t, Size>, Height + 2>, MaxSlots> Rows;
+    std::array<BlockType, MaxSlots> SlotType;
+    // Occupied y range of each slot, so empty bands above and below the
+    // terrain are never scanned.
+    std::array<int, MaxSlots> MinY;
+    std::array<int, MaxSlots> MaxY;
+
+    // Z faces gathered per z plane as rows along y with bits along x.
+    std::array<std::array<uint64_t, Height>, Size> ZPlanes;
+    std::array<uint64_t, Height> Plane;
+    // One slot's rows of the section being read, indexed [y][x].
+    std::array<uint64_t, SectionHeight * Size> SectionRows;
+
+    std::vector<MeshQuad> Quads;
+};
+
+// Merges the set bits of rows[0..count) into rectangles. Runs of bits are
+// found with ctz/countr_one, then grown across following rows while they
+// contain the whole run. Calls emit(row, bit, rowCount, bitCount).
+template<typename EmitFn>
+inline void MergeBitPlane(uint64_t* rows, int count, EmitFn&& emit)
+{
+    for(int r = 0; r < count; ++r)
+    {
+        while(rows[r])
+        {
+            int bit = std::countr_zero(rows[r]);
+            int bitCount = std::countr_one(rows[r] >> bit);
+            uint64_t run = (bitCount == 64 ? ~0ull : ((1ull << bitCount) - 1)) << bit;
+
+            rows[r] &= ~run;
+            int rowCount = 1;
+            while(r + rowCount < count && (rows[r + rowCount] & run) == run)
+            {
+                rows[r + rowCount] &= ~run;
+                ++rowCount;
+            }
+
+            emit(r, bit, rowCount, bitCount);
+        }
+    }
+}
+
+// A uniform section is buried when the sections above and below hide both of
+// its horizontal faces. The chunk floor counts as hidden, the sky does not.
+template<int Size, int Height, typename Layout>
+inline bool SectionBuried(const BasicChunk<Size, Height, Layout>& chunk, int s)
+{
+    const auto& section = chunk.Sections[s];
+    if(!section.Uniform())
+        return false;
+
+    const BlockType type = section.UniformType();
+    auto hides = [type](const auto& neighbor) {
+        if(!neighbor.Uniform())
+            return false;
+        BlockType other = neighbor.UniformType();
+        return type == BlockType::WATER ? other == BlockType::WATER : other != BlockType::AIR;
+    };
+
+    return (s == 0 || hides(chunk.Sections[s - 1])) && s + 1 < chunk.SectionCount && hides(chunk.Sections[s + 1]);
+}
+
+// Meshes from per-type occupancy bitmasks instead of per-voxel neighbor
+// lookups. Visible faces of a whole row are found with one AND-NOT against
+// the neighboring row (or the row shifted by one for z faces) and merged
+// greedily with bit scans. Produces the same faces as the naive mesher,
+// except that empty and buried sections are skipped: buried sections only
+// have faces on the chunk walls, which cannot be seen from above ground.
+template<int Size, int Height, typename Layout>
+inline void GenerateChunkMeshBinary(const BasicChunk<Size, Height, Layout>& chunk, ChunkMesh& mesh)
+{
+    using Scratch = BinaryMeshScratch<Size, Height>;
+    using Border = typename BasicChunk<Size, Height, Layout>::Border;
+    constexpr int SectionCount = BasicChunk<Size, Height, Layout>::SectionCount;
+
+    static thread_local std::unique_ptr<Scratch> t_Scratch;
+    if(!t_Scratch)
+        t_Scratch = std::make_unique<Scratch>();
+    Scratch& scratch = *t_Scratch;
+
+    auto& rows = scratch.Rows;
+    auto& quads = scratch.Quads;
+    quads.clear();
+    size_t waterQuads = 0;
+
+    // Buried sections still fill their rows since they hide their
+    // neighbors' faces, but are never scanned for faces of their own.
+    std::array<bool, SectionCount> meshed;
+    int lowY = Height;
+    int highY = -1;
+
+    // One slot per non-air palette entry. Rows are matched against the packed
+    // palette indices directly, without decoding the blocks.
+    int slotCount = 1;
+    scratch.SlotType[0] = BlockType::AIR;
+    for(int s = 0; s < SectionCount; ++s)
+    {
+        const auto& section = chunk.Sections[s];
+        meshed[s] = !section.Empty() && !SectionBuried(chunk, s);
+        if(section.Empty())
+            continue;
+
+        lowY = std::min(lowY, s * SectionHeight);
+        highY = std::max(highY, std::min((s + 1) * SectionHeight, Height) - 1);
+
+        for(BlockType type : section.Blocks.Palette())
+        {
+            if(type == BlockType::AIR || slotCount == Scratch::MaxSlots)
+                continue;
+            if(std::find(scratch.SlotType.begin() + 1, scratch.SlotType.begin() + slotCount, type) != scratch.SlotType.begin() + slotCount)
+                continue;
+
+            scratch.SlotType[slotCount] = type;
+            scratch.MinY[slotCount] = Height;
+            scratch.MaxY[slotCount] = -1;
+            ++slotCount;
+        }
+    }
+
+    if(highY < 0)
+    {
+        mesh.Clear();
+        return;
+    }
+
+    // Only the rows between the lowest and highest non-empty section (plus
+    // the padding row on each side) are ever read, so only those are cleared.
+    for(int slot = 0; slot < slotCount; ++slot)
+        std::fill(rows[slot].begin() + lowY, rows[slot].begin() + highY + 3, std::array<uint64_t, Size>{});
+
+    constexpr uint64_t fullRow = BasicChunk<Size, Height, Layout>::FullRow;
+    for(int s = 0; s < SectionCount; ++s)
+    {
+        const auto& section = chunk.Sections[s];
+        if(section.Empty())
+            continue;
+
+        const int baseY = s * SectionHeight;
+        const int endY = std::min(baseY + SectionHeight, Height);
+
+        if(section.Uniform())
+        {
+            const BlockType type = section.UniformType();
+            const int slot = (int)(std::find(scratch.SlotType.begin() + 1, scratch.SlotType.begin() + slotCount, type) - scratch.SlotType.begin());
+            if(slot == slotCount)
+                continue;
+
+            for(int y = baseY; y < endY; ++y)
+            {
+                rows[slot][y + 1].fill(fullRow);
+                rows[0][y + 1].fill(fullRow);
+            }
+            if(meshed[s])
+            {
+                scratch.MinY[slot] = std::min(scratch.MinY[slot], baseY);
+                scratch.MaxY[slot] = std::max(scratch.MaxY[slot], endY - 1);
+            }
+            continue;
+        }
+
+        // Each layout matches its own runs of blocks and hands back rows.
+        const std::vector<BlockType>& palette = section.Blocks.Palette();
+        uint64_t* match = scratch.SectionRows.data();
+        for(int slot = 1; slot < slotCount; ++slot)
+        {
+            if(std::find(palette.begin(), palette.end(), scratch.SlotType[slot]) == palette.end())
+                continue;
+
+            section.MatchRows(endY - baseY, scratch.SlotType[slot], match);
+            for(int y = baseY; y < endY; ++y)
+            {
+                const uint64_t* layer = match + (y - baseY) * Size;
+                uint64_t any = 0;
+                for(int x = 0; x < Size; ++x)
+                {
+                    rows[slot][y + 1][x] = layer[x];
+                    rows[0][y + 1][x] |= layer[x];
+                    any |= layer[x];
+                }
+                if(any)
+                {
+                    scratch.MinY[slot] = std::min(scratch.MinY[slot], y);
+                    scratch.MaxY[slot] = std::max(scratch.MaxY[slot], y);
+                }
+            }
+        }
+    }
+
+    uint64_t* plane = scratch.Plane.data();
+
+    for(int s = 1; s < slotCount; ++s)
+    {
+        const BlockType type = scratch.SlotType[s];
+        // Solid blocks are hidden by any neighbor, water only by water.
+        const auto& self = rows[s];
+        const auto& occ = rows[type == BlockType::WATER ? s : 0];
+        const int minY = scratch.MinY[s];
+        const int maxY = scratch.MaxY[s];
+        const int spanY = maxY - minY + 1;
+        const size_t firstQuad = quads.size();
+        // Palette entries can outlive the last block of their type.
+        if(spanY <= 0)
+            continue;
+
+        for(int side = 0; side < 2; ++side)
+        {
+            const bool positive = side == 1;
+            const int step = positive ? 1 : -1;
+
+            // Neighbor edge layers hiding faces on the chunk walls. A missing
+            // neighbor hides nothing.
+            const Border& xBorder = chunk.Borders[(int)(positive ? ChunkSide::POS_X : ChunkSide::NEG_X)];
+            const Border& zBorder = chunk.Borders[(int)(positive ? ChunkSide::POS_Z : ChunkSide::NEG_Z)];
+            auto borderRow = [water = type == BlockType::WATER](const Border& border, int y) {
+                return border.Present ? (water ? border.Water[y] : border.Solid[y]) : 0;
+            };
+
+            // X faces: one plane per x, rows along y, bits along z.
+            for(int x = 0; x < Size; ++x)
+            {
+                const int nx = x + step;
+                const bool edge = nx < 0 || nx >= Size;
+                for(int y = minY; y <= maxY; ++y)
+                    plane[y - minY] = meshed[y / SectionHeight] ? self[y + 1][x] & ~(edge ? borderRow(xBorder, y) : occ[y + 1][nx]) : 0;
+
+                MergeBitPlane(plane, spanY, [&](int row, int bit, int rowCount, int bitCount) {
+                    quads.push_back({ { (uint16_t)x, (uint16_t)(minY + row), (uint16_t)bit },
+                                      (uint16_t)rowCount, (uint16_t)bitCount, 0, positive, type });
+                });
+            }
+
+            // Y faces: one plane per y, rows along x, bits along z.
+            for(int y = minY; y <= maxY; ++y)
+            {
+                if(!meshed[y / SectionHeight])
+                    continue;
+
+                for(int x = 0; x < Size; ++x)
+                    plane[x] = self[y + 1][x] & ~occ[y + 1 + step][x];
+
+                MergeBitPlane(plane, Size, [&](int row, int bit, int rowCount, int bitCount) {
+                    quads.push_back({ { (uint16_t)row, (uint16_t)y, (uint16_t)bit },
+                                      (uint16_t)bitCount, (uint16_t)rowCount, 1, positive, type });
+                });
+            }
+
+            // Z faces: the neighbor along z sits in the same word, so the
+            // faces come from a shifted AND-NOT. They are then scattered into
+            // per-z planes; only face bits are visited, not every voxel.
+            // Plane rows are indexed y - minY, so rows [0, spanY) are the
+            // ones written and merged.
+            auto& zPlanes = scratch.ZPlanes;
+            for(auto& zPlane : zPlanes)
+                std::fill(zPlane.begin(), zPlane.begin() + spanY, 0);
+
+            for(int y = minY; y <= maxY; ++y)
+            {
+                if(!meshed[y / SectionHeight])
+                    continue;
+
+                const uint64_t zEdge = borderRow(zBorder, y);
+                for(int x = 0; x < Size; ++x)
+                {
+                    // The block past the last one along z is the neighbor's.
+                    const uint64_t edgeBit = (zEdge >> x) & 1;
+                    uint64_t neighbor = positive ? (occ[y + 1][x] >> 1) | (edgeBit << (Size - 1)) : (occ[y + 1][x] << 1) | edgeBit;
+                    uint64_t faces = self[y + 1][x] & ~neighbor;
+                    while(faces)
+                    {
+                        int z = std::countr_zero(faces);
+                        zPlanes[z][y - minY] |= 1ull << x;
+                        faces &= faces - 1;
+                    }
+                }
+            }
+
+            for(int z = 0; z < Size; ++z)
+            {
+                MergeBitPlane(zPlanes[z].data(), spanY, [&](int row, int bit, int rowCount, int bitCount) {
+                    quads.push_back({ { (uint16_t)bit, (uint16_t)(minY + row), (uint16_t)z },
+                                      (uint16_t)bitCount, (uint16_t)rowCount, 2, positive, type });
+                });
+            }
+        }
+
+        if(type == BlockType::WATER)
+            waterQuads += quads.size() - firstQuad;
+    }
+
+    EmitQuads(quads, waterQuads, mesh);
+}
+
+template<int Size, int Height, typename Layout>
+inline void GenerateChunkMesh(const BasicChunk<Size, Height, Layout>& chunk, ChunkMesh& mesh, MeshMode mode)
+{
+    switch(mode)
+    {
+        case MeshMode::NAIVE: GenerateChunkMeshNaive(chunk, mesh); break;
+        case MeshMode::GREEDY: GenerateChunkMeshGreedy(chunk, mesh); break;
+        case MeshMode::BINARY: GenerateChunkMeshBinary(chunk, mesh); break;
+    }
+}
+
+inline const char* MeshModeName(MeshMode mode)
+{
+    switch(mode)
+    {
+        case MeshMode::NAIVE: return "Naive";
+        case MeshMode::GREEDY: return "Greedy";
+        case MeshMode::BINARY: return "Binary";
+        default: return "Unknown";
+    }
+}
+
+struct MeshStats
+{
+    size_t Vertices = 0;
+    size_t Indices = 0;
+    // Mesh size in the packed format, and what the same mesh took with float
+    // vertices and 32-bit indices.
+    size_t Bytes = 0;
+    size_t UnpackedBytes = 0;
+    float TimeMs = 0.0f;
+    // Heap allocations per mesh into an empty mesh, and into one reused from
+    // the previous iteration like a recycled chunk's. Only counted when
+    // CountsAllocations is set; see allocCounter.hpp.
+    bool CountsAllocations = false;
+    float Allocations = 0.0f;
+    float ReusedAllocations = 0.0f;
+    float ReusedTimeMs = 0.0f;
+};
+
+// Meshes the chunk into a scratch mesh so modes can be compared on identical
+// data. TimeMs and Allocations average iterations that each start from an
+// empty mesh, like a freshly loaded chunk does; the Reused figures keep
+// meshing into the same one. One untimed run first sets up the thread's
+// mesher scratch buffers, as any worker would have after its first chunk.
+template<int Size, int Height, typename Layout>
+inline MeshStats MeasureMesh(const BasicChunk<Size, Height, Layout>& chunk, MeshMode mode, int iterations = 1)
+{
+    ChunkMesh mesh;
+    GenerateChunkMesh(chunk, mesh, mode);
+
+    MeshStats stats;
+    stats.CountsAllocations = AllocationCountingEnabled;
+    size_t allocations = ThreadAllocationCount();
+    Timer timer;
+    for(int i = 0; i < iterations; ++i)
+    {
+        mesh = ChunkMesh();
+        GenerateChunkMesh(chunk, mesh, mode);
+    }
+    stats.TimeMs = timer.ElapsedMilli() / iterations;
+    stats.Allocations = (float)(ThreadAllocationCount() - allocations) / iterations;
+
+    allocations = ThreadAllocationCount();
+    timer.Start();
+    for(int i = 0; i < iterations; ++i)
+    {
+        GenerateChunkMesh(chunk, mesh, mode);
+    }
+    stats.ReusedTimeMs = timer.ElapsedMilli() / iterations;
+    stats.ReusedAllocations = (float)(ThreadAllocationCount() - allocations) / iterations;
+
+    stats.Vertices = mesh.VertexCount();
+    stats.Indices = mesh.IndexCount();
+    stats.Bytes = mesh.MemoryUsage();
+    stats.UnpackedBytes = stats.Vertices * UnpackedVertexBytes + stats.Indices * sizeof(unsigned int);
+    return stats;
+}
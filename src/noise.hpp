@@ -1,11 +1,54 @@
 #pragma once
 
+#include <cstring>
+#include <memory>
+#include <vector>
 
 #include <FastNoise/FastNoise.h>
+#include "heightmapCache.hpp"
+#include "util.hpp"
 
 
+// Heights of a CountX by CountY block of chunks starting at (ChunkX, ChunkY),
+// generated together. Values holds the whole block row by row, so a chunk's
+// rows are CountX chunk widths apart.
+struct HeightmapBatch
+{
+    int ChunkX = 0;
+    int ChunkY = 0;
+    int CountX = 0;
+    int CountY = 0;
+    int ChunkWidth = 0;
+    int ChunkHeight = 0;
+    std::vector<float> Values;
+
+    bool Contains(int chunkX, int chunkY) const
+    {
+        return chunkX >= ChunkX && chunkX < ChunkX + CountX && chunkY >= ChunkY && chunkY < ChunkY + CountY;
+    }
+
+    HeightmapView View(int chunkX, int chunkY) const
+    {
+        const int stride = CountX * ChunkWidth;
+        const int offset = (chunkY - ChunkY) * ChunkHeight * stride + (chunkX - ChunkX) * ChunkWidth;
+        return { Values.data() + offset, stride };
+    }
+};
+
+// A batch and the tiles cut from it. Tiles are handed out as shared pointers
+// aliasing the block, so the samples are never copied out of the batch; the
+// block lives until its last tile is evicted and released.
+struct HeightmapBlock
+{
+    HeightmapBatch Batch;
+    std::vector<HeightmapTile> Tiles;
+};
+
 class NoiseGen {
 public:
+    // 16 MB of 32x32 tiles.
+    static constexpr size_t DefaultHeightmapTiles = 4096;
+
     NoiseGen(int octaves, float lacunarity, float gain, int seed, int width, int height)
         : m_Simplex(FastNoise::New<FastNoise::Simplex>()), m_Fractal(FastNoise::New<FastNoise::FractalFBm>()),
           m_Octaves(octaves), m_Lacunarity(lacunarity), m_Gain(gain), m_Seed(seed),
@@ -28,11 +71,109 @@ public:
         return noiseVals;
     }
 
-    void SetOctaveCount(int n) { m_Octaves = n; m_Fractal->SetOctaveCount(n); }
-    void SetLacunarity(float lac) { m_Lacunarity = lac; m_Fractal->SetLacunarity(lac); }
-    void SetGain(float gain) { m_Gain = gain; m_Fractal->SetGain(gain); }
-    void SetSeed(int seed) { m_Seed = seed; }
-    void SetChunkDims(int w, int h) { m_ChunkWidth = w; m_ChunkHeight = h; }
+    // Same samples as GenerateNoise2D for each chunk of the block, from a
+    // single grid call: the per-call setup and the SIMD tail are paid once
+    // for the block instead of once per chunk. batch's storage is reused.
+    void GenerateNoise2D(int chunkX, int chunkY, int countX, int countY, int featureSize, HeightmapBatch& batch) const
+    {
+        batch.ChunkX = chunkX;
+        batch.ChunkY = chunkY;
+        batch.CountX = countX;
+        batch.CountY = countY;
+        batch.ChunkWidth = m_ChunkWidth;
+        batch.ChunkHeight = m_ChunkHeight;
+        batch.Values.resize((size_t)countX * m_ChunkWidth * countY * m_ChunkHeight);
+
+        float startX = (-m_ChunkWidth / 2.0f) + (chunkX * m_ChunkWidth);
+        float startY = (-m_ChunkHeight / 2.0f) + (chunkY * m_ChunkHeight);
+        float frequency = 1.0f / featureSize;
+
+        m_Fractal->GenUniformGrid2D(batch.Values.data(), startX, startY, countX * m_ChunkWidth, countY * m_ChunkHeight,
+                                    frequency, m_Seed);
+    }
+
+    // Identifies every parameter the samples depend on. Tiles cached under
+    // one hash are never returned for another.
+    uint64_t ParamHash(int featureSize) const
+    {
+        uint32_t lacunarity, gain;
+        std::memcpy(&lacunarity, &m_Lacunarity, sizeof(float));
+        std::memcpy(&gain, &m_Gain, sizeof(float));
+
+        uint64_t hash = HashChunkKey(PackChunkKey(m_Seed, m_Octaves));
+        hash = HashChunkKey(hash ^ PackChunkKey((int32_t)lacunarity, (int32_t)gain));
+        hash = HashChunkKey(hash ^ PackChunkKey(m_ChunkWidth, m_ChunkHeight));
+        return HashChunkKey(hash ^ (uint64_t)featureSize);
+    }
+
+    // The chunk's heights, from the tile cache when they were generated
+    // before. For one-off queries such as minimaps or height lookups.
+    HeightmapCache::TilePtr GetHeightmap(int chunkX, int chunkY, int featureSize) const
+    {
+        const uint64_t params = ParamHash(featureSize);
+        HeightmapCache::TilePtr tile = m_HeightmapCache.Find(params, chunkX, chunkY);
+        if(tile)
+            return tile;
+
+        auto block = std::make_shared<HeightmapBlock>();
+        GenerateNoise2D(chunkX, chunkY, 1, 1, featureSize, block->Batch);
+        block->Tiles.push_back({ block->Batch.View(chunkX, chunkY) });
+        HeightmapCache::TilePtr generated(block, &block->Tiles[0]);
+        m_HeightmapCache.Insert(params, chunkX, chunkY, generated);
+        return generated;
+    }
+
+    // Heights of a block of chunks, row by row, into tiles. Cached tiles are
+    // reused; if any is missing the whole block is generated in one batch
+    // and the missing tiles are views into it, without copying the samples.
+    // A cached tile keeps its whole batch alive, so the cache's footprint is
+    // only close to its tile count while tiles of a batch are evicted
+    // together, as the strips the world generates are.
+    void GetHeightmaps(int chunkX, int chunkY, int countX, int countY, int featureSize,
+                       std::vector<HeightmapCache::TilePtr>& tiles) const
+    {
+        const uint64_t params = ParamHash(featureSize);
+        tiles.assign((size_t)countX * countY, nullptr);
+        bool missing = false;
+        for(int y = 0; y < countY; ++y)
+        {
+            for(int x = 0; x < countX; ++x)
+            {
+                tiles[y * countX + x] = m_HeightmapCache.Find(params, chunkX + x, chunkY + y);
+                missing |= !tiles[y * countX + x];
+            }
+        }
+        if(!missing)
+            return;
+
+        auto block = std::make_shared<HeightmapBlock>();
+        GenerateNoise2D(chunkX, chunkY, countX, countY, featureSize, block->Batch);
+        block->Tiles.resize(tiles.size());
+        for(int y = 0; y < countY; ++y)
+        {
+            for(int x = 0; x < countX; ++x)
+            {
+                HeightmapCache::TilePtr& tile = tiles[y * countX + x];
+                if(tile)
+                    continue;
+
+                HeightmapTile& generated = block->Tiles[y * countX + x];
+                generated.Heights = block->Batch.View(chunkX + x, chunkY + y);
+                tile = HeightmapCache::TilePtr(block, &generated);
+                m_HeightmapCache.Insert(params, chunkX + x, chunkY + y, tile);
+            }
+        }
+    }
+
+    const HeightmapCache& GetHeightmapCache() const { return m_HeightmapCache; }
+    void ResetHeightmapCacheStats() { m_HeightmapCache.ResetStats(); }
+
+    // Changing any parameter invalidates every cached tile.
+    void SetOctaveCount(int n) { m_Octaves = n; m_Fractal->SetOctaveCount(n); m_HeightmapCache.Clear(); }
+    void SetLacunarity(float lac) { m_Lacunarity = lac; m_Fractal->SetLacunarity(lac); m_HeightmapCache.Clear(); }
+    void SetGain(float gain) { m_Gain = gain; m_Fractal->SetGain(gain); m_HeightmapCache.Clear(); }
+    void SetSeed(int seed) { m_Seed = seed; m_HeightmapCache.Clear(); }
+    void SetChunkDims(int w, int h) { m_ChunkWidth = w; m_ChunkHeight = h; m_HeightmapCache.Clear(); }
 
     float Lacunarity() const { return m_Lacunarity; }
     float Gain() const { return m_Gain; }
@@ -50,4 +191,42 @@ private:
     int   m_Seed;
     int   m_ChunkWidth;
     int   m_ChunkHeight;
+    // Filled from worker threads; the cache locks internally.
+    mutable HeightmapCache m_HeightmapCache{DefaultHeightmapTiles};
+};
+
+struct HeightmapStats
+{
+    // Noise samples generated per second.
+    double PerChunkCellsPerSec = 0.0;
+    double BatchedCellsPerSec = 0.0;
 };
+
+// Generates a strip of chunks heights chunk by chunk, then as one batch, the
+// way a new row of the loaded window is generated.
+inline HeightmapStats MeasureHeightmaps(const NoiseGen& noise, int stripChunks, int featureSize, int iterations = 1)
+{
+    const double cells = (double)stripChunks * noise.Width() * noise.Height() * iterations;
+    HeightmapStats stats;
+    HeightmapBatch batch;
+    // Untimed run, so the batch's storage and FastNoise's setup are warm.
+    noise.GenerateNoise2D(0, 0, stripChunks, 1, featureSize, batch);
+
+    Timer timer;
+    for(int i = 0; i < iterations; ++i)
+    {
+        for(int c = 0; c < stripChunks; ++c)
+        {
+            noise.GenerateNoise2D(c, i, featureSize);
+        }
+    }
+    stats.PerChunkCellsPerSec = cells / timer.Elapsed();
+
+    timer.Start();
+    for(int i = 0; i < iterations; ++i)
+    {
+        noise.GenerateNoise2D(0, i, stripChunks, 1, featureSize, batch);
+    }
+    stats.BatchedCellsPerSec = cells / timer.Elapsed();
+    return stats;
+}
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+
+// Stores count values of a small enum as indices into a palette of the
+// distinct values in use. Indices are bit-packed into 64-bit words with 0, 1,
+// 2, 4 or 8 bits each; power-of-two widths keep an index from straddling two
+// words. A single-entry palette needs no index data at all. The width grows
+// (and the data is repacked) whenever the palette outgrows it.
+template<typename T>
+class PaletteStorage
+{
+public:
+    PaletteStorage(size_t count, T initial = T{})
+        : m_Palette{initial}, m_Count(count)
+    {}
+
+    T Get(size_t index) const
+    {
+        if(m_Bits == 0)
+            return m_Palette[0];
+        return m_Palette[ReadIndex(m_Data, m_Bits, index)];
+    }
+
+    void Set(size_t index, T value)
+    {
+        uint32_t paletteIndex = FindOrAdd(value);
+        if(m_Bits == 0)
+            return;
+        WriteIndex(index, paletteIndex);
+    }
+
+    // Unpacks count values starting at start into out.
+    void Decode(size_t start, size_t count, T* out) const
+    {
+        if(m_Bits == 0)
+        {
+            std::fill(out, out + count, m_Palette[0]);
+            return;
+        }
+
+        const uint32_t mask = (1u << m_Bits) - 1;
+        const int wordShift = WordShift(m_Bits);
+        const size_t perWord = (size_t)1 << wordShift;
+        size_t index = start;
+        size_t end = start + count;
+        while(index < end)
+        {
+            uint64_t word = m_Data[index >> wordShift] >> ((index & (perWord - 1)) * m_Bits);
+            size_t wordEnd = std::min(end, ((index >> wordShift) + 1) << wordShift);
+            for(; index < wordEnd; ++index)
+            {
+                *out++ = m_Palette[word & mask];
+                word >>= m_Bits;
+            }
+        }
+    }
+
+    // Bit i of the result is set when the value at start + i equals value.
+    // Works on the packed words directly: each index field is XORed against
+    // the wanted index, folded down to one bit and compacted. count <= 64.
+    uint64_t MatchMask(size_t start, int count, T value) const
+    {
+        if(m_Bits == 0)
+            return m_Palette[0] == value ? (count == 64 ? ~0ull : (1ull << count) - 1) : 0;
+
+        int paletteIndex = -1;
+        for(size_t i = 0; i < m_Palette.size(); ++i)
+        {
+            if(m_Palette[i] == value)
+            {
+                paletteIndex = (int)i;
+                break;
+            }
+        }
+        if(paletteIndex < 0)
+            return 0;
+
+        switch(m_Bits)
+        {
+            case 1: return MatchPacked<1>(start, count, (uint64_t)paletteIndex);
+            case 2: return MatchPacked<2>(start, count, (uint64_t)paletteIndex);
+            case 4: return MatchPacked<4>(start, count, (uint64_t)paletteIndex);
+            default: return MatchPacked<8>(start, count, (uint64_t)paletteIndex);
+        }
+    }
+
+    // Resets every value to one type. The index data is dropped but its
+    // buffer is kept, so storage that is refilled later doesn't reallocate.
+    void Fill(T value)
+    {
+        m_Palette.assign(1, value);
+        m_Data.clear();
+        m_Bits = 0;
+    }
+
+    // Replaces every value in one go, for callers that pack the indices
+    // themselves: palette becomes the palette, and the returned words, all
+    // zero, take bits-wide indices laid out the way Set writes them. bits
+    // must be 1, 2, 4 or 8 and wide enough for the palette.
+    uint64_t* Overwrite(std::initializer_list<T> palette, int bits)
+    {
+        m_Palette.assign(palette);
+        m_Bits = bits;
+        const size_t perWord = 64 / bits;
+        m_Data.assign((m_Count + perWord - 1) / perWord, 0);
+        return m_Data.data();
+    }
+
+    size_t Count() const { return m_Count; }
+    int BitsPerValue() const { return m_Bits; }
+    const std::vector<T>& Palette() const { return m_Palette; }
+    bool Uniform() const { return m_Bits == 0; }
+
+    // Heap bytes used by the palette and the packed indices. Buffers kept
+    // around by Fill for reuse are not counted.
+    size_t MemoryUsage() const
+    {
+        return m_Palette.size() * sizeof(T) + m_Data.size() * sizeof(uint64_t);
+    }
+
+private:
+    template<int Bits>
+    uint64_t MatchPacked(size_t start, int count, uint64_t paletteIndex) const
+    {
+        constexpr int wordShift = 6 - std::countr_zero((unsigned int)Bits);
+        constexpr int perWord = 1 << wordShift;
+        constexpr uint64_t lowBits = LowBits(Bits);
+        const uint64_t pattern = lowBits * paletteIndex;
+
+        uint64_t result = 0;
+        int produced = 0;
+        size_t index = start;
+        while(produced < count)
+        {
+            const int offset = (int)(index & (perWord - 1));
+            uint64_t x = m_Data[index >> wordShift] ^ pattern;
+            for(int shift = 1; shift < Bits; shift <<= 1)
+                x |= x >> shift;
+
+            uint64_t matches = CompactFields(~x & lowBits, Bits) >> offset;
+            const int take = std::min(perWord - offset, count - produced);
+            result |= (take == 64 ? matches : matches & ((1ull << take) - 1)) << produced;
+            produced += take;
+            index += take;
+        }
+        return result;
+    }
+
+    // Lowest bit of every bits-wide field.
+    static constexpr uint64_t LowBits(int bits)
+    {
+        switch(bits)
+        {
+            case 1: return ~0ull;
+            case 2: return 0x5555555555555555ull;
+            case 4: return 0x1111111111111111ull;
+            case 8: return 0x0101010101010101ull;
+            default: return 0;
+        }
+    }
+
+    // Gathers bit 0 of every bits-wide field into the low 64 / bits bits.
+    static constexpr uint64_t CompactFields(uint64_t v, int bits)
+    {
+        switch(bits)
+        {
+            case 1:
+                return v;
+            case 2:
+                v = (v | (v >> 1)) & 0x3333333333333333ull;
+                v = (v | (v >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+                v = (v | (v >> 4)) & 0x00FF00FF00FF00FFull;
+                v = (v | (v >> 8)) & 0x0000FFFF0000FFFFull;
+                return (v | (v >> 16)) & 0x00000000FFFFFFFFull;
+            case 4:
+                v = (v | (v >> 3)) & 0x0303030303030303ull;
+                v = (v | (v >> 6)) & 0x000F000F000F000Full;
+                v = (v | (v >> 12)) & 0x000000FF000000FFull;
+                return (v | (v >> 24)) & 0x000000000000FFFFull;
+            case 8:
+                v = (v | (v >> 7)) & 0x0003000300030003ull;
+                v = (v | (v >> 14)) & 0x0000000F0000000Full;
+                return (v | (v >> 28)) & 0x00000000000000FFull;
+            default:
+                return 0;
+        }
+    }
+
+    // log2 of the number of fields per word, so word lookups are shifts.
+    static int WordShift(int bits)
+    {
+        return 6 - std::countr_zero((unsigned int)bits);
+    }
+
+    static uint32_t ReadIndex(const std::vector<uint64_t>& data, int bits, size_t index)
+    {
+        const int wordShift = WordShift(bits);
+        uint64_t word = data[index >> wordShift];
+        return (uint32_t)(word >> ((index & ((1u << wordShift) - 1)) * bits)) & ((1u << bits) - 1);
+    }
+
+    void WriteIndex(size_t index, uint32_t value)
+    {
+        const int wordShift = WordShift(m_Bits);
+        const int shift = (int)(index & ((1u << wordShift) - 1)) * m_Bits;
+        const uint64_t mask = (uint64_t)((1u << m_Bits) - 1) << shift;
+        uint64_t& word = m_Data[index >> wordShift];
+        word = (word & ~mask) | ((uint64_t)value << shift);
+    }
+
+    uint32_t FindOrAdd(T value)
+    {
+        for(uint32_t i = 0; i < m_Palette.size(); ++i)
+        {
+            if(m_Palette[i] == value)
+                return i;
+        }
+
+        m_Palette.push_back(value);
+        int required = BitsFor(m_Palette.size());
+        if(required > m_Bits)
+            Repack(required);
+        return (uint32_t)m_Palette.size() - 1;
+    }
+
+    static int BitsFor(size_t paletteSize)
+    {
+        int bits = 0;
+        while(((size_t)1 << bits) < paletteSize)
+            ++bits;
+        // Round up to a width that divides 64.
+        if(bits == 3) return 4;
+        if(bits > 4 && bits <= 8) return 8;
+        return bits;
+    }
+
+    // Widens the indices in place. Field i only ever moves to a higher bit
+    // offset, so walking from the last field down never overwrites a field
+    // that hasn't been read yet, and no second buffer is needed.
+    void Repack(int bits)
+    {
+        const int oldBits = m_Bits;
+        const int perWord = 64 / bits;
+        m_Bits = bits;
+
+        // Going from a uniform storage, every index is 0.
+        if(oldBits == 0)
+        {
+            m_Data.assign((m_Count + perWord - 1) / perWord, 0);
+            return;
+        }
+
+        m_Data.resize((m_Count + perWord - 1) / perWord, 0);
+        for(size_t i = m_Count; i-- > 0;)
+        {
+            WriteIndex(i, ReadIndex(m_Data, oldBits, i));
+        }
+    }
+
+private:
+    std::vector<T> m_Palette;
+    std::vector<uint64_t> m_Data;
+    size_t m_Count;
+    int m_Bits = 0;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+// Counts the calling thread's L1 data cache read misses through the kernel's
+// perf events. Off Linux, or when perf_event_paranoid doesn't allow it, the
+// counter is invalid and always reads 0.
+class CacheMissCounter
+{
+public:
+    CacheMissCounter()
+    {
+#ifdef __linux__
+        perf_event_attr attr = {};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_Fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~CacheMissCounter()
+    {
+#ifdef __linux__
+        if(m_Fd >= 0)
+            close(m_Fd);
+#endif
+    }
+
+    CacheMissCounter(const CacheMissCounter&) = delete;
+    CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+    bool Valid() const { return m_Fd >= 0; }
+
+    void Start()
+    {
+#ifdef __linux__
+        if(m_Fd < 0)
+            return;
+        ioctl(m_Fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_Fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    // Misses since Start.
+    uint64_t Stop()
+    {
+        uint64_t count = 0;
+#ifdef __linux__
+        if(m_Fd < 0)
+            return 0;
+        ioctl(m_Fd, PERF_EVENT_IOC_DISABLE, 0);
+        if(read(m_Fd, &count, sizeof(count)) != (ssize_t)sizeof(count))
+            count = 0;
+#endif
+        return count;
+    }
+
+private:
+    int m_Fd = -1;
+};
@@ -5,6 +5,7 @@
 
 #include <glad/gl.h>
 #include <glm/gtc/type_ptr.hpp>
+#include "graphics.hpp"
 #include "util.hpp"
 
 
@@ -15,7 +16,7 @@ Shader::Shader(const char* vertPath, const char* fragPath)
 
 Shader::~Shader()
 {
-    glDeleteProgram(id);
+    DeleteShader(id);
 }
 
 unsigned int Shader::CreateShader(const char* vertFile, const char* fragFile)
@@ -52,68 +53,86 @@ unsigned int Shader::CreateShader(const char* vertFile, const char* fragFile)
 
 void Shader::Bind() const
 {
-    glUseProgram(id);
+    BindShader(id);
 }
 
 
+Uniform Shader::GetUniform(const char* name) const
+{
+	auto itemIter = m_UniformLocations.find(name);
+	if(itemIter != m_UniformLocations.end())
+	{
+		return { itemIter->second };
+	}
+
+	Uniform uniform;
+	uniform.Location = glGetUniformLocation(id, name);
+	if(uniform.Location == -1)
+	{
+	    std::cerr << "Uniform: " << name << " does not exist!\n";
+	}
+	m_UniformLocations.emplace(name, uniform.Location);
+	return uniform;
+}
+
+void Shader::SetUniform(Uniform uniform, float val)
+{
+	glUniform1f(uniform.Location, val);
+}
+
+void Shader::SetUniform(Uniform uniform, int val)
+{
+	glUniform1i(uniform.Location, val);
+}
+
+void Shader::SetUniform(Uniform uniform, const glm::vec3& vec)
+{
+	glUniform3fv(uniform.Location, 1, glm::value_ptr(vec));
+}
+
+void Shader::SetUniform(Uniform uniform, const glm::vec4& vec)
+{
+	glUniform4fv(uniform.Location, 1, glm::value_ptr(vec));
+}
+
+void Shader::SetUniform(Uniform uniform, const glm::mat4& mat)
+{
+	glUniformMatrix4fv(uniform.Location, 1, GL_FALSE, glm::value_ptr(mat));
+}
+
 void Shader::SetUniform(const char* name, float val)
 {
-	glUniform1f(GetUniformLocation(*this, name), val);
+	SetUniform(GetUniform(name), val);
 }
 
 void Shader::SetUniform(const char* name, int val)
 {
-	glUniform1i(GetUniformLocation(*this, name), val);
+	SetUniform(GetUniform(name), val);
 }
 
 void Shader::SetUniform(const char* name, const glm::vec3& vec)
 {
-	glUniform3fv(GetUniformLocation(*this, name), 1, glm::value_ptr(vec));
+	SetUniform(GetUniform(name), vec);
 }
 
 void Shader::SetUniform(const char* name, float x, float y, float z)
 {
-	glUniform3f(GetUniformLocation(*this, name), x, y, z);
+	SetUniform(GetUniform(name), glm::vec3(x, y, z));
 }
 
 void Shader::SetUniform(const char* name, const glm::vec4& vec)
 {
-	glUniform4fv(GetUniformLocation(*this, name), 1, glm::value_ptr(vec));
+	SetUniform(GetUniform(name), vec);
 }
 
 void Shader::SetUniform(const char* name, float x, float y, float z, float w)
 {
-	glUniform4f(GetUniformLocation(*this, name), x, y, z, w);
+	SetUniform(GetUniform(name), glm::vec4(x, y, z, w));
 }
 
 void Shader::SetUniform(const char* name, const glm::mat4& mat)
 {
-	glUniformMatrix4fv(GetUniformLocation(*this, name), 1, GL_FALSE, glm::value_ptr(mat));
-}
-
-int Shader::GetUniformLocation(Shader& shader, const char* name) {
-	auto itemIter = shader.Uniforms.find(name);
-
-	if (itemIter != shader.Uniforms.end())
-	{
-		return itemIter->second;
-	}
-
-	int loc = glGetUniformLocation(shader.id, name);
-
-	if(loc == -1)
-	{
-	    static bool done = false;
-	    if(!done)
-	    {
-	        done = true;
-	        std::cerr << "Uniform: " << name << " does not exist!\n";
-	    }
-		return loc;
-	}
-
-	shader.Uniforms[name] = loc;
-	return loc;
+	SetUniform(GetUniform(name), mat);
 }
 
 void Shader::CheckShaderCompile(unsigned int shader, unsigned int type)
@@ -1,9 +1,18 @@
 #pragma once
 
+#include <string>
 #include <unordered_map>
 
 #include <glm/glm.hpp>
 
+
+// Location of a uniform in one program, looked up once by Shader::GetUniform
+// so per-frame updates don't go through a name lookup.
+struct Uniform
+{
+    int Location = -1;
+};
+
 class Shader
 {
 public:
@@ -14,6 +23,18 @@ public:
 
     void Bind() const;
 
+    // Resolves name with the driver the first time it is asked for and
+    // caches the location, missing ones included, so a missing uniform is
+    // reported once. Call at setup and keep the result.
+    Uniform GetUniform(const char* name) const;
+
+    void SetUniform(Uniform uniform, float val);
+    void SetUniform(Uniform uniform, int val);
+    void SetUniform(Uniform uniform, const glm::vec3& vec);
+    void SetUniform(Uniform uniform, const glm::vec4& vec);
+    void SetUniform(Uniform uniform, const glm::mat4& mat);
+
+    // Go through GetUniform's cache by name; fine for one-off setup.
     void SetUniform(const char* name, float val);
     void SetUniform(const char* name, int val);
 
@@ -25,12 +46,11 @@ public:
 
     void SetUniform(const char* name, const glm::mat4& mat);
 
-    std::unordered_map<const char*, int> Uniforms;
-
 private:
     unsigned int CreateShader(const char* vertFile, const char* fragFile);
     void CheckShaderCompile(unsigned int shader, unsigned int type);
     void CheckShaderLink(unsigned int shader);
-    int GetUniformLocation(Shader& shader, const char* name);
     const char* ShaderTypeToName(unsigned int type);
+
+    mutable std::unordered_map<std::string, int> m_UniformLocations;
 };
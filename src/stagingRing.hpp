@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include <glad/gl.h>
+#include "graphics.hpp"
+
+
+// Persistently mapped, coherent upload buffer used as a ring. Data written to
+// a reserved range is copied to its destination on the GPU; Fence marks
+// everything reserved so far as in use by the copies issued so far, and
+// Reclaim hands ranges back once their fence has signalled. Nothing ever
+// waits on the GPU: when the ring is full, Reserve fails and the caller tries
+// again on a later frame. Main thread only.
+class StagingRing
+{
+public:
+    StagingRing(size_t capacity)
+        : m_Capacity(capacity)
+    {}
+
+    ~StagingRing()
+    {
+        for(const PendingFence& fence : m_Fences)
+            glDeleteSync(fence.Sync);
+    }
+
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    // Reserves size contiguous bytes. Fails if they don't fit until more of
+    // the ring is reclaimed.
+    bool Reserve(size_t size, size_t& offset)
+    {
+        offset = 0;
+        if(size == 0)
+            return true;
+        if(size > m_Capacity)
+            return false;
+        if(!m_Buffer)
+            Create();
+
+        // A range never wraps; the tail end of the ring is skipped instead.
+        size_t padding = m_Head + size > m_Capacity ? m_Capacity - m_Head : 0;
+        if(Used() + padding + size > m_Capacity)
+            return false;
+
+        m_Allocated += padding;
+        m_Head = padding ? 0 : m_Head;
+        offset = m_Head;
+        m_Head += size;
+        m_Allocated += size;
+        return true;
+    }
+
+    uint8_t* Data() { return m_Data; }
+    unsigned int Buffer() const { return m_Buffer.Get(); }
+
+    // Call after issuing the copies that read what was reserved so far.
+    void Fence()
+    {
+        if(!m_Fences.empty() && m_Fences.back().Allocated == m_Allocated)
+            return;
+        if(m_Allocated == m_Released)
+            return;
+
+        m_Fences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), m_Allocated });
+    }
+
+    // Frees the ranges whose copies the GPU has finished.
+    void Reclaim()
+    {
+        while(!m_Fences.empty())
+        {
+            const PendingFence& fence = m_Fences.front();
+            GLenum status = glClientWaitSync(fence.Sync, 0, 0);
+            if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                break;
+
+            glDeleteSync(fence.Sync);
+            m_Released = fence.Allocated;
+            m_Fences.pop_front();
+        }
+    }
+
+    size_t Capacity() const { return m_Capacity; }
+    size_t Used() const { return m_Allocated - m_Released; }
+    size_t PendingFences() const { return m_Fences.size(); }
+
+private:
+    struct PendingFence
+    {
+        GLsync Sync;
+        // Value of m_Allocated when the fence was inserted.
+        uint64_t Allocated;
+    };
+
+    void Create()
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        BindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBufferStorage(GL_COPY_READ_BUFFER, (GLsizeiptr)m_Capacity, nullptr, flags);
+        m_Data = (uint8_t*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, (GLsizeiptr)m_Capacity, flags);
+        m_Buffer.Reset(buffer);
+    }
+
+private:
+    BufferHandle m_Buffer;
+    uint8_t* m_Data = nullptr;
+    size_t m_Capacity;
+    size_t m_Head = 0;
+    // Running byte totals, padding included; their difference is in use.
+    uint64_t m_Allocated = 0;
+    uint64_t m_Released = 0;
+    std::deque<PendingFence> m_Fences;
+};
@@ -0,0 +1,517 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "chunk.hpp"
+#include "heightmapCache.hpp"
+#include "noise.hpp"
+#include "util.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define TERRAIN_FILL_X86 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC compiles any intrinsic it is given, whatever the target.
+#define FILL_TARGET_SSE2
+#define FILL_TARGET_AVX2
+#else
+#define FILL_TARGET_SSE2 __attribute__((target("sse2")))
+#define FILL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+
+// Empty space below this height fills with water.
+static const int WaterLevel = 30;
+
+// Instruction set the terrain fill runs its kernels with.
+enum class SimdLevel : uint8_t
+{
+    SCALAR = 0,
+    SSE2,
+    AVX2,
+};
+static const int SimdLevelCount = 3;
+
+inline const char* SimdLevelName(SimdLevel level)
+{
+    switch(level)
+    {
+        case SimdLevel::SCALAR: return "Scalar";
+        case SimdLevel::SSE2: return "SSE2";
+        case SimdLevel::AVX2: return "AVX2";
+    }
+    return "Unknown";
+}
+
+// Highest level the CPU and OS support.
+inline SimdLevel DetectSimdLevel()
+{
+#if defined(TERRAIN_FILL_X86) && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool sse2 = info[3] & (1 << 26);
+    // AVX registers are only usable once the OS saves them.
+    const bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    if(avx && maxLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        if(info[1] & (1 << 5))
+            return SimdLevel::AVX2;
+    }
+    return sse2 ? SimdLevel::SSE2 : SimdLevel::SCALAR;
+#elif defined(TERRAIN_FILL_X86)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+    if(__builtin_cpu_supports("sse2"))
+        return SimdLevel::SSE2;
+    return SimdLevel::SCALAR;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+// Detected once, on first use.
+inline SimdLevel SupportedSimdLevel()
+{
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+}
+
+// A chunk's column heights, normalized to the highest dirt block of each
+// column. Indexed [x][z], so the columns of one section row along z are
+// contiguous and can be compared against a layer all at once.
+template<int Size>
+struct ColumnHeights
+{
+    static_assert(Size % 16 == 0 && Size <= 64, "Rows of columns are compared 16 at a time and fit a word");
+
+    std::array<uint8_t, Size * Size> Top;
+    int Min = 0;
+    int Max = 0;
+
+    const uint8_t* Row(int x) const { return &Top[x * Size]; }
+};
+
+// Scale applied to heightmap samples once moved to [0, 1], for a chunk
+// Height blocks tall. Heights are clamped to the chunk, so a sample a little
+// outside [-1, 1] still leaves a floor at y = 0 and never reaches past the
+// top. Column tops are stored and compared as bytes.
+template<int Height>
+constexpr float ColumnHeightScale = (float)(Height - 1);
+
+template<int Size, int Height>
+inline void NormalizeHeightsScalar(HeightmapView heightMap, ColumnHeights<Size>& out)
+{
+    static_assert(Height <= 256, "Column heights must fit a byte");
+    constexpr float scale = ColumnHeightScale<Height>;
+    float lowest = scale;
+    float highest = 0.0f;
+    for(int z = 0; z < Size; ++z)
+    {
+        for(int x = 0; x < Size; ++x)
+        {
+            float height = (heightMap(x, z) + 1.0f) / 2.0f * scale;
+            height = std::min(std::max(height, 0.0f), scale);
+            lowest = std::min(lowest, height);
+            highest = std::max(highest, height);
+            out.Top[x * Size + z] = (uint8_t)height;
+        }
+    }
+    // Truncation is monotonic, so the extremes can be converted last.
+    out.Min = (int)lowest;
+    out.Max = (int)highest;
+}
+
+// Bit z of rows[x * layers + i] is set when column (x, z) is dirt at layer
+// baseY + i.
+template<int Size>
+inline void SolidRowsScalar(const ColumnHeights<Size>& heights, int baseY, int layers, uint64_t* rows)
+{
+    for(int x = 0; x < Size; ++x)
+    {
+        const uint8_t* top = heights.Row(x);
+        for(int i = 0; i < layers; ++i)
+        {
+            const int y = baseY + i;
+            uint64_t row = 0;
+            for(int z = 0; z < Size; ++z)
+                row |= (uint64_t)(top[z] >= y) << z;
+            rows[x * layers + i] = row;
+        }
+    }
+}
+
+#ifdef TERRAIN_FILL_X86
+template<int Size, int Height>
+FILL_TARGET_SSE2 inline void NormalizeHeightsSse2(HeightmapView heightMap, ColumnHeights<Size>& out)
+{
+    static_assert(Height <= 256, "Column heights must fit a byte");
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 scale = _mm_set1_ps(ColumnHeightScale<Height>);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 lowest = scale;
+    __m128 highest = zero;
+    alignas(16) int32_t lanes[4];
+    for(int z = 0; z < Size; ++z)
+    {
+        const float* row = heightMap.Data + (size_t)z * heightMap.Stride;
+        for(int x = 0; x < Size; x += 4)
+        {
+            __m128 height = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(row + x), one), half), scale);
+            height = _mm_min_ps(_mm_max_ps(height, zero), scale);
+            lowest = _mm_min_ps(lowest, height);
+            highest = _mm_max_ps(highest, height);
+            _mm_store_si128((__m128i*)lanes, _mm_cvttps_epi32(height));
+            for(int k = 0; k < 4; ++k)
+                out.Top[(x + k) * Size + z] = (uint8_t)lanes[k];
+        }
+    }
+
+    alignas(16) float low[4], high[4];
+    _mm_store_ps(low, lowest);
+    _mm_store_ps(high, highest);
+    out.Min = (int)*std::min_element(low, low + 4);
+    out.Max = (int)*std::max_element(high, high + 4);
+}
+
+// Bytes are unsigned, so top >= y is tested as max(top, y) == top.
+template<int Size>
+FILL_TARGET_SSE2 inline void SolidRowsSse2(const ColumnHeights<Size>& heights, int baseY, int layers, uint64_t* rows)
+{
+    for(int x = 0; x < Size; ++x)
+    {
+        const uint8_t* top = heights.Row(x);
+        for(int i = 0; i < layers; ++i)
+        {
+            const __m128i y = _mm_set1_epi8((char)(baseY + i));
+            uint64_t row = 0;
+            for(int z = 0; z < Size; z += 16)
+            {
+                const __m128i columns = _mm_loadu_si128((const __m128i*)(top + z));
+                const __m128i solid = _mm_cmpeq_epi8(_mm_max_epu8(columns, y), columns);
+                row |= (uint64_t)(uint32_t)_mm_movemask_epi8(solid) << z;
+            }
+            rows[x * layers + i] = row;
+        }
+    }
+}
+
+template<int Size, int Height>
+FILL_TARGET_AVX2 inline void NormalizeHeightsAvx2(HeightmapView heightMap, ColumnHeights<Size>& out)
+{
+    static_assert(Size % 8 == 0, "Rows are normalized 8 samples at a time");
+    static_assert(Height <= 256, "Column heights must fit a byte");
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 scale = _mm256_set1_ps(ColumnHeightScale<Height>);
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 lowest = scale;
+    __m256 highest = zero;
+    alignas(32) int32_t lanes[8];
+    for(int z = 0; z < Size; ++z)
+    {
+        const float* row = heightMap.Data + (size_t)z * heightMap.Stride;
+        for(int x = 0; x < Size; x += 8)
+        {
+            __m256 height = _mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(row + x), one), half), scale);
+            height = _mm256_min_ps(_mm256_max_ps(height, zero), scale);
+            lowest = _mm256_min_ps(lowest, height);
+            highest = _mm256_max_ps(highest, height);
+            _mm256_store_si256((__m256i*)lanes, _mm256_cvttps_epi32(height));
+            for(int k = 0; k < 8; ++k)
+                out.Top[(x + k) * Size + z] = (uint8_t)lanes[k];
+        }
+    }
+
+    alignas(32) float low[8], high[8];
+    _mm256_store_ps(low, lowest);
+    _mm256_store_ps(high, highest);
+    out.Min = (int)*std::min_element(low, low + 8);
+    out.Max = (int)*std::max_element(high, high + 8);
+}
+
+template<int Size>
+FILL_TARGET_AVX2 inline void SolidRowsAvx2(const ColumnHeights<Size>& heights, int baseY, int layers, uint64_t* rows)
+{
+    for(int x = 0; x < Size; ++x)
+    {
+        const uint8_t* top = heights.Row(x);
+        for(int i = 0; i < layers; ++i)
+        {
+            const __m256i y = _mm256_set1_epi8((char)(baseY + i));
+            uint64_t row = 0;
+            int z = 0;
+            for(; z + 32 <= Size; z += 32)
+            {
+                const __m256i columns = _mm256_loadu_si256((const __m256i*)(top + z));
+                const __m256i solid = _mm256_cmpeq_epi8(_mm256_max_epu8(columns, y), columns);
+                row |= (uint64_t)(uint32_t)_mm256_movemask_epi8(solid) << z;
+            }
+            if constexpr(Size % 32 != 0)
+            {
+                const __m128i columns = _mm_loadu_si128((const __m128i*)(top + z));
+                const __m128i solid = _mm_cmpeq_epi8(_mm_max_epu8(columns, _mm256_castsi256_si128(y)), columns);
+                row |= (uint64_t)(uint32_t)_mm_movemask_epi8(solid) << z;
+            }
+            rows[x * layers + i] = row;
+        }
+    }
+}
+#endif
+
+template<int Size, int Height>
+inline void NormalizeHeights(HeightmapView heightMap, ColumnHeights<Size>& out, SimdLevel level)
+{
+#ifdef TERRAIN_FILL_X86
+    switch(level)
+    {
+        case SimdLevel::AVX2: NormalizeHeightsAvx2<Size, Height>(heightMap, out); return;
+        case SimdLevel::SSE2: NormalizeHeightsSse2<Size, Height>(heightMap, out); return;
+        default: break;
+    }
+#endif
+    NormalizeHeightsScalar<Size, Height>(heightMap, out);
+}
+
+template<int Size>
+inline void SolidRows(const ColumnHeights<Size>& heights, int baseY, int layers, uint64_t* rows, SimdLevel level)
+{
+#ifdef TERRAIN_FILL_X86
+    switch(level)
+    {
+        case SimdLevel::AVX2: SolidRowsAvx2(heights, baseY, layers, rows); return;
+        case SimdLevel::SSE2: SolidRowsSse2(heights, baseY, layers, rows); return;
+        default: break;
+    }
+#endif
+    SolidRowsScalar(heights, baseY, layers, rows);
+}
+
+// Moves bit i of v to bit 2i.
+inline uint64_t SpreadBits(uint32_t v)
+{
+    uint64_t x = v;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | (x << 2)) & 0x3333333333333333ull;
+    return (x | (x << 1)) & 0x5555555555555555ull;
+}
+
+// Spreads the bits of mask to bits-wide fields, as many as fit a word.
+inline uint64_t SpreadFields(uint64_t mask, int bits)
+{
+    return bits == 1 ? mask : SpreadBits((uint32_t)mask);
+}
+
+// Palette indices a section is packed with.
+struct SectionCodes
+{
+    int Bits;
+    uint64_t Dirt;
+    // Blocks above the column top, below WaterLevel and from it up.
+    uint64_t Water;
+    uint64_t Air;
+};
+
+// Writes a non-uniform section straight into its packed storage. Every
+// column is dirt up to its top, water above that up to WaterLevel and air
+// beyond, so the palette is known up front from which of those the section
+// can hold and the indices are never repacked. Each layout is then packed
+// along the runs it keeps contiguous: rows of columns from their solid
+// masks, whole columns from one template per column top, and Morton order
+// block by block.
+template<int Height, typename Section>
+inline void FillSection(Section& section, const ColumnHeights<Section::Size>& heights, int baseY, int topY, SimdLevel level)
+{
+    using Layout = typename Section::Layout;
+    constexpr int Size = Section::Size;
+    const int layers = topY - baseY + 1;
+    const bool hasDirt = baseY <= heights.Max;
+    const bool hasWater = baseY < WaterLevel && heights.Min < std::min(topY, WaterLevel - 1);
+    const bool hasAir = topY >= WaterLevel;
+
+    uint64_t* words;
+    SectionCodes codes;
+    if(hasDirt && hasWater && hasAir)
+    {
+        words = section.Blocks.Overwrite({ BlockType::AIR, BlockType::DIRT, BlockType::WATER }, 2);
+        codes = { 2, 1, 2, 0 };
+    }
+    else if(!hasDirt)
+    {
+        // Water over air, no dirt reaching this high.
+        words = section.Blocks.Overwrite({ BlockType::AIR, BlockType::WATER }, 1);
+        codes = { 1, 0, 1, 0 };
+    }
+    else
+    {
+        words = section.Blocks.Overwrite({ hasWater ? BlockType::WATER : BlockType::AIR, BlockType::DIRT }, 1);
+        codes = { 1, 1, 0, 0 };
+    }
+
+    // Bit i set for the layers below WaterLevel.
+    const uint64_t allLayers = (1ull << layers) - 1;
+    const uint64_t waterLayers = allLayers & (WaterLevel <= baseY ? 0 : WaterLevel > topY ? ~0ull : (1ull << (WaterLevel - baseY)) - 1);
+
+    if constexpr(Layout::Id == BlockLayout::Y_COLUMNS)
+    {
+        static_assert(SectionHeight * 2 <= 64, "A packed column must fit a word");
+        std::array<uint64_t, Height> templates;
+        for(int top = heights.Min; top <= heights.Max; ++top)
+        {
+            const uint64_t dirt = top < baseY ? 0 : top >= topY ? allLayers : (2ull << (top - baseY)) - 1;
+            const uint64_t other = allLayers & ~dirt;
+            templates[top - heights.Min] = SpreadFields(dirt, codes.Bits) * codes.Dirt |
+                                           SpreadFields(other & waterLayers, codes.Bits) * codes.Water |
+                                           SpreadFields(other & ~waterLayers, codes.Bits) * codes.Air;
+        }
+
+        for(int x = 0; x < Size; ++x)
+        {
+            const uint8_t* top = heights.Row(x);
+            for(int z = 0; z < Size; ++z)
+            {
+                const size_t bit = Layout::Index(x, 0, z) * codes.Bits;
+                words[bit >> 6] |= templates[top[z] - heights.Min] << (bit & 63);
+            }
+        }
+        return;
+    }
+
+    if constexpr(Layout::Id == BlockLayout::MORTON)
+    {
+        // Code of a non-dirt block per layer. Layers past the top of the
+        // chunk are never below a column top, so they come out as air.
+        std::array<uint64_t, SectionHeight> otherCodes;
+        for(int i = 0; i < SectionHeight; ++i)
+            otherCodes[i] = i >= layers ? codes.Air : (waterLayers >> i) & 1 ? codes.Water : codes.Air;
+
+        // Walked in storage order, so each word is assembled in a register
+        // and stored once. The lowest three index bits are z, x and y, so
+        // every 8 blocks are a 2x2x2 cube over 2x2 columns.
+        const int lanesPerWord = 64 / codes.Bits;
+        for(size_t start = 0; start < Section::BlockCount; start += lanesPerWord)
+        {
+            const std::array<int, 3> base = Layout::Tables.Coords(start);
+            uint64_t packed = 0;
+            for(int lane = 0; lane < lanesPerWord; lane += 8)
+            {
+                const std::array<uint8_t, 3>& low = Layout::Tables.LowCoords[lane];
+                const int x = base[0] + low[0];
+                const int i = base[1] + low[1];
+                const int z = base[2] + low[2];
+                const uint8_t* near = heights.Row(x) + z;
+                const uint8_t* far = heights.Row(x + 1) + z;
+                const int tops[4] = { near[0], near[1], far[0], far[1] };
+                for(int k = 0; k < 8; ++k)
+                {
+                    const bool solid = tops[k & 3] >= baseY + i + (k >> 2);
+                    packed |= (solid ? codes.Dirt : otherCodes[i + (k >> 2)]) << ((lane + k) * codes.Bits);
+                }
+            }
+            words[start / lanesPerWord] = packed;
+        }
+        return;
+    }
+
+    std::array<uint64_t, Size * SectionHeight> rows;
+    SolidRows(heights, baseY, layers, rows.data(), level);
+
+    constexpr uint64_t fullRow = Size == 64 ? ~0ull : (1ull << Size) - 1;
+    for(int x = 0; x < Size; ++x)
+    {
+        for(int i = 0; i < layers; ++i)
+        {
+            const uint64_t solid = rows[x * layers + i];
+            const uint64_t other = ~solid & fullRow;
+            const uint64_t otherCode = (waterLayers >> i) & 1 ? codes.Water : codes.Air;
+
+            const int lanesPerWord = 64 / codes.Bits;
+            for(int z = 0; z < Size; z += lanesPerWord)
+            {
+                const uint64_t packed = SpreadFields(solid >> z, codes.Bits) * codes.Dirt |
+                                        SpreadFields(other >> z, codes.Bits) * otherCode;
+                const size_t bit = Layout::Index(x, i, z) * codes.Bits;
+                words[bit >> 6] |= packed << (bit & 63);
+            }
+        }
+    }
+}
+
+// Fills a chunk's blocks from its heightmap, overwriting whatever it held.
+// Sections entirely below the lowest column, or entirely above the highest
+// one, hold a single type and are filled without visiting their blocks.
+template<int Size, int Height, typename Layout>
+inline void FillChunkBlocks(BasicChunk<Size, Height, Layout>& chunk, HeightmapView heightMap, SimdLevel level = SupportedSimdLevel())
+{
+    ColumnHeights<Size> heights;
+    NormalizeHeights<Size, Height>(heightMap, heights, level);
+
+    chunk.TerrainTop = heights.Max + 1;
+    chunk.WaterBottom = heights.Min + 1;
+    chunk.WaterTop = std::max(chunk.WaterBottom, std::min(WaterLevel, Height));
+
+    for(int s = 0; s < chunk.SectionCount; ++s)
+    {
+        auto& section = chunk.Sections[s];
+        const int baseY = s * SectionHeight;
+        const int topY = std::min(baseY + SectionHeight, Height) - 1;
+
+        if(topY <= heights.Min)
+            section.Fill(BlockType::DIRT);
+        else if(baseY > heights.Max && topY < WaterLevel)
+            section.Fill(BlockType::WATER);
+        else if(baseY > heights.Max && baseY >= WaterLevel)
+            section.Fill(BlockType::AIR);
+        else
+            FillSection<Height>(section, heights, baseY, topY, level);
+    }
+}
+
+struct TerrainFillStats
+{
+    double NoiseMsPerChunk = 0.0;
+    // Indexed by SimdLevel; levels the CPU lacks are left at 0.
+    std::array<double, SimdLevelCount> FillMsPerChunk = {};
+};
+
+// Times heightmap generation against filling the blocks from it, at every
+// supported level, over chunks distinct heightmaps.
+inline TerrainFillStats MeasureTerrainFill(const NoiseGen& noise, int featureSize, int chunks)
+{
+    TerrainFillStats stats;
+    std::vector<std::vector<float>> heightMaps(chunks);
+
+    Timer timer;
+    for(int c = 0; c < chunks; ++c)
+    {
+        heightMaps[c] = noise.GenerateNoise2D(c, 0, featureSize);
+    }
+    stats.NoiseMsPerChunk = timer.ElapsedMilli() / chunks;
+
+    auto chunk = std::make_unique<Chunk>();
+    for(int level = 0; level <= (int)SupportedSimdLevel(); ++level)
+    {
+        // Untimed run, so the sections' buffers are allocated.
+        FillChunkBlocks(*chunk, { heightMaps[0].data(), noise.Width() }, (SimdLevel)level);
+
+        timer.Start();
+        for(int c = 0; c < chunks; ++c)
+        {
+            FillChunkBlocks(*chunk, { heightMaps[c].data(), noise.Width() }, (SimdLevel)level);
+        }
+        stats.FillMsPerChunk[level] = timer.ElapsedMilli() / chunks;
+    }
+    return stats;
+}
@@ -1,6 +1,7 @@
 #include "texture.hpp"
 
 #include <glad/gl.h>
+#include "graphics.hpp"
 
 #include <iostream>
 #include <vector>
@@ -38,7 +39,7 @@ Texture::Texture(const char* path)
             case 4: format = GL_RGBA; break;
         }
 
-        glBindTexture(GL_TEXTURE_2D, id);
+        BindTexture(0, id);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -59,13 +60,13 @@ Texture::Texture(const char* path)
 
 Texture::~Texture()
 {
-    glDeleteTextures(1, &id);
+    DeleteTexture(id);
 }
 Texture& Texture::operator=(Texture&& tex)
 {
     if(this != &tex)
     {
-        glDeleteTextures(1, &id);
+        DeleteTexture(id);
         id = tex.id;
         width = tex.width;
         height = tex.height;
@@ -79,13 +80,12 @@ Texture& Texture::operator=(Texture&& tex)
 
 void Texture::Bind(unsigned int slot) const
 {
-    glActiveTexture(GL_TEXTURE0 + slot);
-    glBindTexture(GL_TEXTURE_2D, id);
+    BindTexture(slot, id);
 }
 
-void Texture::Unbind() const
+void Texture::Unbind(unsigned int slot) const
 {
-    glBindTexture(GL_TEXTURE_2D, 0);
+    BindTexture(slot, 0);
 }
 
 // Caller owns texture.
@@ -93,7 +93,7 @@ Texture* CreateTextureFromFloats(int width, int height, const std::vector<float>
 {
     unsigned int id;
     glGenTextures(1, &id);
-    glBindTexture(GL_TEXTURE_2D, id);
+    BindTexture(0, id);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, data.data());
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -108,7 +108,7 @@ Texture* CreateTextureFromBytes(int width, int height, const std::vector<uint8_t
 {
     unsigned int id;
     glGenTextures(1, &id);
-    glBindTexture(GL_TEXTURE_2D, id);
+    BindTexture(0, id);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -22,7 +22,7 @@ struct Texture
     Texture& operator=(Texture&& tex);
 
     void Bind(unsigned int slot = 0) const;
-    void Unbind() const;
+    void Unbind(unsigned int slot = 0) const;
 
     unsigned int id;
     int width;
@@ -6,7 +6,7 @@
 #include <sstream>
 #include <chrono>
 
-static std::string ReadFile(const char* path)
+inline std::string ReadFile(const char* path)
 {
     std::ifstream file(path);
     if(!file.is_open())
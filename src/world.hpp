@@ -1,357 +1,688 @@
 #pragma once
 
-#include <unordered_map>
+#include <algorithm>
 #include <array>
+#include <cstdlib>
+#include <deque>
 #include <memory>
+#include <thread>
 
 #include <glm/glm.hpp>
+#include "chunk.hpp"
+#include "chunkCache.hpp"
+#include "chunkGrid.hpp"
+#include "chunkMap.hpp"
+#include "chunkPool.hpp"
+#include "chunkRenderer.hpp"
+#include "frustum.hpp"
 #include "graphics.hpp"
+#include "jobSystem.hpp"
+#include "lockFreeQueue.hpp"
+#include "mesher.hpp"
 #include "noise.hpp"
+#include "terrainFill.hpp"
 
 
-static const int ChunkSize = 32;
-static const int ChunkHeight = 100;
-static const int ActiveRadius = 5;
+// Size of the terrain's hills, in blocks.
+static const int TerrainFeatureSize = 256;
 
- enum class BlockType : uint8_t { AIR = 0, DIRT,
-    ROCK,
-    SAND,
-    SNOW,
-    WATER
+// Container holding the loaded chunks.
+enum class ChunkStorage
+{
+    HASH_MAP = 0,
+    RING_GRID,
 };
+static const int ChunkStorageCount = 2;
 
+inline const char* ChunkStorageName(ChunkStorage storage)
+{
+    switch(storage)
+    {
+        case ChunkStorage::HASH_MAP: return "Hash map";
+        case ChunkStorage::RING_GRID: return "Ring grid";
+        default: return "Unknown";
+    }
+}
 
-struct Chunk
+class World
 {
-    int32_t X;
-    int32_t Y;
-    std::array<std::array<std::array<BlockType, ChunkSize>, ChunkHeight>, ChunkSize> Blocks;
+    // Runs fn on whichever container is in use. Both share one interface.
+    // Defined first since the deduced return type must be known before use.
+    template<typename Fn>
+    decltype(auto) VisitChunks(Fn&& fn)
+    {
+        if(m_ChunkStorage == ChunkStorage::RING_GRID)
+            return fn(m_ChunkGrid);
+        return fn(m_ChunkMap);
+    }
 
-    std::vector<float> Vertices;
-    std::vector<unsigned int> Indices;
-    unsigned int Vao;
-    unsigned int Vbo;
-    unsigned int Ibo;
+    template<typename Fn>
+    decltype(auto) VisitChunks(Fn&& fn) const
+    {
+        if(m_ChunkStorage == ChunkStorage::RING_GRID)
+            return fn(m_ChunkGrid);
+        return fn(m_ChunkMap);
+    }
 
-    std::vector<float> WaterVertices;
-    std::vector<unsigned int> WaterIndices;
-    unsigned int WaterVao;
-    unsigned int WaterVbo;
-    unsigned int WaterIbo;
+public:
+    World()
+        : m_NoiseGen(6, 2.0f, 0.5f, 0, ChunkSize, ChunkSize)
+    {
+        m_RenderList.reserve(WindowChunks);
+    }
 
-    Chunk() : X(0), Y(0), Blocks(), Vao(0), Vbo(0), Ibo(0), WaterVao(0), WaterVbo(0), WaterIbo(0)
-    {}
+    // Most chunks that can be loaded at once: everything within UnloadRadius.
+    static constexpr int WindowChunks = (2 * UnloadRadius + 1) * (2 * UnloadRadius + 1);
+    static constexpr size_t DefaultCacheBytes = 64ull << 20;
+    static constexpr size_t DefaultUploadBudgetBytes = 2ull << 20;
 
-    Chunk(int32_t x, int32_t y)
-        : X(x), Y(y), Blocks(), Vao(0), Vbo(0), Ibo(0), WaterVao(0), WaterVbo(0), WaterIbo(0)
-    {}
+    ~World()
+    {
+        // Workers spin while the completion queue is full, so keep draining
+        // it until they are all done.
+        while(!m_Jobs.Idle())
+        {
+            DiscardCompletedChunks();
+            std::this_thread::yield();
+        }
+        DiscardCompletedChunks();
+    }
 
-    ~Chunk()
+    const Chunk* GetChunk(int x, int y) const
+    {
+        const std::unique_ptr<Chunk>* chunk = VisitChunks([&](const auto& chunks) { return chunks.Find(x, y); });
+        return chunk ? chunk->get() : nullptr;
+    }
+    void GenChunk(int x, int y)
     {
-        if(Vao) glDeleteVertexArrays(1, &Vao);
-        if(Vbo) glDeleteBuffers(1, &Vbo);
-        if(Ibo) glDeleteBuffers(1, &Ibo);
-        if(WaterVao) glDeleteVertexArrays(1, &WaterVao);
-        if(WaterVbo) glDeleteBuffers(1, &WaterVbo);
-        if(WaterIbo) glDeleteBuffers(1, &WaterIbo);
+        m_NewChunks.clear();
+        AddChunk(x, y);
+        SubmitGenerationJobs(m_NewChunks);
     }
 
-    void Render() const
+    const NoiseGen& GetNoiseGen() const { return m_NoiseGen; }
+    NoiseGen& GetNoiseGen() { return m_NoiseGen; }
+
+    size_t PendingChunks() const { return m_PendingChunks; }
+    size_t PendingUploads() const { return m_UploadQueue.size(); }
+    size_t GetUploadBudget() const { return m_UploadBudgetBytes; }
+    void SetUploadBudget(size_t bytes) { m_UploadBudgetBytes = bytes; }
+    const ChunkPool& GetChunkPool() const { return m_ChunkPool; }
+    const ChunkCache& GetChunkCache() const { return m_ChunkCache; }
+    ChunkRenderer& GetChunkRenderer() { return m_Renderer; }
+    void ResetChunkCacheStats() { m_ChunkCache.ResetStats(); }
+    void SetChunkCacheBytes(size_t bytes)
     {
-        glBindVertexArray(Vao);
-        glDrawElements(GL_TRIANGLES, Indices.size(), GL_UNSIGNED_INT, 0);
+        m_ChunkCache.SetCapacityBytes(bytes, [this](std::unique_ptr<Chunk> chunk) { m_ChunkPool.Release(std::move(chunk)); });
     }
+    void SetCacheChunkMeshes(bool keep) { m_ChunkCache.SetKeepMeshes(keep); }
+    unsigned int WorkerCount() const { return m_Jobs.WorkerCount(); }
 
-    void RenderWater() const
+    // Average block storage of the loaded chunks, to compare against Chunk::DenseBlockBytes.
+    size_t AverageBlockBytes() const
     {
-        glBindVertexArray(WaterVao);
-        glDrawElements(GL_TRIANGLES, WaterIndices.size(), GL_UNSIGNED_INT, 0);
+        size_t total = 0;
+        size_t count = 0;
+        VisitChunks([&](const auto& chunks) {
+            chunks.ForEach([&](int32_t, int32_t, const std::unique_ptr<Chunk>& chunk) {
+                if(chunk && chunk->State == ChunkState::READY)
+                {
+                    total += chunk->BlockMemoryUsage();
+                    ++count;
+                }
+            });
+        });
+        return count ? total / count : 0;
     }
 
-    void CreateGLObjs()
+    float AverageUniformSections() const
     {
-        const unsigned int stride = sizeof(float) * 8;
-        if(Vao) glDeleteVertexArrays(1, &Vao);
-        if(Vbo) glDeleteBuffers(1, &Vbo);
-        if(Ibo) glDeleteBuffers(1, &Ibo);
-    
-        Vao = CreateVertexArray();
-        Vbo = CreateVertexBuffer(Vertices.data(), sizeof(float) * Vertices.size());
-        Ibo = CreateIndexBuffer(Indices.data(), sizeof(unsigned int) * Indices.size());
-        AddVertexAttrib(Vao, 0, VertexAttribType::FLOAT, 3, stride, 0);
-        AddVertexAttrib(Vao, 1, VertexAttribType::FLOAT, 3, stride, sizeof(float) * 3);
-        AddVertexAttrib(Vao, 2, VertexAttribType::FLOAT, 2, stride, sizeof(float) * 6);
+        size_t total = 0;
+        size_t count = 0;
+        VisitChunks([&](const auto& chunks) {
+            chunks.ForEach([&](int32_t, int32_t, const std::unique_ptr<Chunk>& chunk) {
+                if(chunk && chunk->State == ChunkState::READY)
+                {
+                    total += chunk->UniformSectionCount();
+                    ++count;
+                }
+            });
+        });
+        return count ? (float)total / count : 0.0f;
+    }
 
-        if(WaterVao) glDeleteVertexArrays(1, &WaterVao);
-        if(WaterVbo) glDeleteBuffers(1, &WaterVbo);
-        if(WaterIbo) glDeleteBuffers(1, &WaterIbo);
+    ChunkStorage GetChunkStorage() const { return m_ChunkStorage; }
+    // Like mesh modes, switching storage reloads the window.
+    void SetChunkStorage(ChunkStorage storage)
+    {
+        if(storage == m_ChunkStorage)
+            return;
 
-        WaterVao = CreateVertexArray();
-        WaterVbo = CreateVertexBuffer(WaterVertices.data(), sizeof(float) * WaterVertices.size());
-        WaterIbo = CreateIndexBuffer(WaterIndices.data(), sizeof(unsigned int) * WaterIndices.size());
-        AddVertexAttrib(WaterVao, 0, VertexAttribType::FLOAT, 3, stride, 0);
-        AddVertexAttrib(WaterVao, 1, VertexAttribType::FLOAT, 3, stride, sizeof(float) * 3);
-        AddVertexAttrib(WaterVao, 2, VertexAttribType::FLOAT, 2, stride, sizeof(float) * 6);
+        UnloadAllChunks();
+        m_ChunkStorage = storage;
     }
-};
 
-using ChunkKey = std::pair<int32_t, int32_t>;
-struct HashPair
-{
-    size_t operator()(const std::pair<int32_t, int32_t>& p) const
+    MeshMode GetMeshMode() const { return m_MeshMode; }
+    // Switching modes unloads every chunk so the whole window is remeshed with
+    // the new mesher. Cached block data is still reused.
+    void SetMeshMode(MeshMode mode)
     {
-        auto hash1 = std::hash<int32_t>{}(p.first);
-        auto hash2 = std::hash<int32_t>{}(p.second);
-        return hash1 ^ hash2;
+        if(mode == m_MeshMode)
+            return;
+
+        // Loaded meshes are cached under the mode they were built with.
+        UnloadAllChunks();
+        m_MeshMode = mode;
     }
-};
 
-inline void AddFace(std::vector<float>& vertices, std::vector<unsigned int>& indices, unsigned int& indexOffset,
-                    glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, glm::vec3 v3,
-                    glm::vec3 normal, glm::vec2 texCoord0, glm::vec2 texCoord1, glm::vec2 texCoord2, glm::vec2 texCoord3)
-{
-    vertices.insert(vertices.end(), {
-                v0.x, v0.y, v0.z, normal.x, normal.y, normal.z, texCoord0.x, texCoord0.y,
-                v1.x, v1.y, v1.z, normal.x, normal.y, normal.z, texCoord1.x, texCoord1.y,
-                v2.x, v2.y, v2.z, normal.x, normal.y, normal.z, texCoord2.x, texCoord2.y,
-                v3.x, v3.y, v3.z, normal.x, normal.y, normal.z, texCoord3.x, texCoord3.y
-    });
-
-    indices.insert(indices.end(), { indexOffset, indexOffset + 1, indexOffset + 2, indexOffset, indexOffset + 2, indexOffset + 3 });
-    indexOffset += 4;
-}
+    // Triangles currently uploaded for the loaded chunks.
+    size_t DrawnTriangles() const
+    {
+        size_t quads = 0;
+        for(const Chunk* chunk : m_RenderList)
+        {
+            quads += (chunk->TerrainMesh.Count() + chunk->WaterMesh.Count()) / 4;
+        }
+        return quads * 2;
+    }
 
-inline void GenerateChunkMesh(Chunk& chunk)
-{
-    chunk.Vertices.clear();
-    chunk.Indices.clear();
-    chunk.WaterVertices.clear();
-    chunk.WaterIndices.clear();
-    unsigned int indexOffset = 0;
-    unsigned int waterIndexOffset = 0;
-
-    const glm::vec2 dirtTexCoords[4] = {
-        {0.5f, 0.5f}, {0.5f, 1.0f}, {0.0f, 1.0f}, {0.0f, 0.5f}
-    };
-    const glm::vec2 rockTexCoords[4] = {
-        {0.5f, 0.5f}, {1.0f, 0.5f}, {1.0f, 1.0f}, {0.5f, 1.0f}
-    };
-    const glm::vec2 sandTexCoords[4] = {
-        {0.5f, 0.0f}, {1.0f, 0.0f}, {1.0f, 0.5f}, {0.5f, 0.5f}
-    };
-    const glm::vec2 snowTexCoords[4] = {
-        {0.0f, 0.0f}, {0.5f, 0.0f}, {0.5f, 0.5f}, {0.0f, 0.5f}
-    };
-    const glm::vec2 waterTexCoords[4] = {
-        {0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}
-    };
-
-    for (int x = 0; x < ChunkSize; ++x)
-    {
-        for (int y = 0; y < ChunkHeight; ++y)
+    // Remeshes every ready chunk with and without its neighbors' borders to
+    // show how many triangles cross-chunk culling saves.
+    void MeasureBorderCulling(size_t& withBorders, size_t& withoutBorders)
+    {
+        withBorders = 0;
+        withoutBorders = 0;
+        ChunkMesh mesh;
+        for(const Chunk* renderChunk : m_RenderList)
         {
-            for (int z = 0; z < ChunkSize; ++z)
+            if(renderChunk->State != ChunkState::READY)
+                continue;
+
+            // No job touches a ready chunk, so its borders can be switched
+            // off and back on here.
+            Chunk& chunk = *FindChunk(renderChunk->X, renderChunk->Y);
+            GenerateChunkMesh(chunk, mesh, m_MeshMode);
+            withBorders += mesh.IndexCount() / 3;
+
+            std::array<bool, ChunkSideCount> present;
+            for(int side = 0; side < ChunkSideCount; ++side)
             {
-                if (chunk.Blocks[x][y][z] == BlockType::AIR) continue;
+                present[side] = chunk.Borders[side].Present;
+                chunk.Borders[side].Present = false;
+            }
+            GenerateChunkMesh(chunk, mesh, m_MeshMode);
+            withoutBorders += mesh.IndexCount() / 3;
+            for(int side = 0; side < ChunkSideCount; ++side)
+            {
+                chunk.Borders[side].Present = present[side];
+            }
+        }
+    }
 
-                glm::vec3 normal;
-                glm::vec2 const* texCoords = nullptr;
-                switch(chunk.Blocks[x][y][z])
-                {
-                    case BlockType::DIRT: {
-                        texCoords = dirtTexCoords;
-                        break;
-                    }
-                    case BlockType::ROCK: {
-                        texCoords = rockTexCoords;
-                        break;
-                    }
-                    case BlockType::SAND: {
-                        texCoords = sandTexCoords;
-                        break;
-                    }
-                    case BlockType::SNOW: {
-                        texCoords = snowTexCoords;
-                        break;
-                    }
-                    case BlockType::WATER: {
-                        texCoords = waterTexCoords;
-                        break;
-                    }
-                    case BlockType::AIR: {
-                        // continue;
-                        break;
-                    }
-                }
+    // Meshes the chunk under the camera with every mode. Returns false if
+    // that chunk isn't ready yet.
+    bool CompareMeshModes(const glm::vec3& camPos, std::array<MeshStats, MeshModeCount>& stats, int iterations) const
+    {
+        int chunkX = (int)camPos.x / ChunkSize;
+        int chunkY = (int)camPos.z / ChunkSize;
 
-                bool isWater = (chunk.Blocks[x][y][z] == BlockType::WATER);
-                std::vector<float>& vertices = isWater ? chunk.WaterVertices : chunk.Vertices;
-                std::vector<unsigned int>& indices = isWater ? chunk.WaterIndices : chunk.Indices;
-                unsigned int& idxOffset = isWater ? waterIndexOffset : indexOffset;
+        const Chunk* chunk = GetChunk(chunkX, chunkY);
+        if(!chunk || chunk->State != ChunkState::READY)
+            return false;
 
-                if (x == 0 || chunk.Blocks[x - 1][y][z] == BlockType::AIR || (isWater && chunk.Blocks[x - 1][y][z] != BlockType::WATER))
-                {
-                    glm::vec3 normal(-1, 0, 0);
-                    glm::vec3 offsets[4] = {
-                        {0, 0, 0}, {0, 1, 0}, {0, 1, 1}, {0, 0, 1}
-                    };
-                    AddFace(vertices, indices, idxOffset, glm::vec3{x, y, z} + offsets[0], glm::vec3{x, y, z} + offsets[1], glm::vec3{x, y, z} + offsets[2], glm::vec3{x, y, z} + offsets[3], normal, texCoords[0], texCoords[1], texCoords[2], texCoords[3]);
-                }
-                if (x == ChunkSize - 1 || chunk.Blocks[x + 1][y][z] == BlockType::AIR || (isWater && chunk.Blocks[x + 1][y][z] != BlockType::WATER))
-                {
-                    glm::vec3 normal(1, 0, 0);
-                    glm::vec3 offsets[4] = {
-                        {1, 0, 0}, {1, 1, 0}, {1, 1, 1}, {1, 0, 1}
-                    };
-                    AddFace(vertices, indices, idxOffset, glm::vec3{x, y, z} + offsets[0], glm::vec3{x, y, z} + offsets[1], glm::vec3{x, y, z} + offsets[2], glm::vec3{x, y, z} + offsets[3], normal, texCoords[0], texCoords[1], texCoords[2], texCoords[3]);
-                }
-                if (y == 0 || chunk.Blocks[x][y - 1][z] == BlockType::AIR || (isWater && chunk.Blocks[x][y - 1][z] != BlockType::WATER))
-                {
-                    glm::vec3 normal(0, -1, 0);
-                    glm::vec3 offsets[4] = {
-                        {0, 0, 0}, {1, 0, 0}, {1, 0, 1}, {0, 0, 1}
-                    };
-                    AddFace(vertices, indices, idxOffset, glm::vec3{x, y, z} + offsets[0], glm::vec3{x, y, z} + offsets[1], glm::vec3{x, y, z} + offsets[2], glm::vec3{x, y, z} + offsets[3], normal, texCoords[0], texCoords[1], texCoords[2], texCoords[3]);
-                }
-                if (y == ChunkHeight - 1 || chunk.Blocks[x][y + 1][z] == BlockType::AIR || (isWater && chunk.Blocks[x][y + 1][z] != BlockType::WATER))
-                {
-                    glm::vec3 normal(0, 1, 0);
-                    glm::vec3 offsets[4] = {
-                        {0, 1, 0}, {1, 1, 0}, {1, 1, 1}, {0, 1, 1}
-                    };
-                    AddFace(vertices, indices, idxOffset, glm::vec3{x, y, z} + offsets[0], glm::vec3{x, y, z} + offsets[1], glm::vec3{x, y, z} + offsets[2], glm::vec3{x, y, z} + offsets[3], normal, texCoords[0], texCoords[1], texCoords[2], texCoords[3]);
-                }
-                if (z == 0 || chunk.Blocks[x][y][z - 1] == BlockType::AIR || (isWater && chunk.Blocks[x][y][z - 1] != BlockType::WATER))
-                {
-                    glm::vec3 normal(0, 0, -1);
-                    glm::vec3 offsets[4] = {
-                        {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}
-                    };
-                    AddFace(vertices, indices, idxOffset, glm::vec3{x, y, z} + offsets[0], glm::vec3{x, y, z} + offsets[1], glm::vec3{x, y, z} + offsets[2], glm::vec3{x, y, z} + offsets[3], normal, texCoords[0], texCoords[1], texCoords[2], texCoords[3]);
-                }
-                if (z == ChunkSize - 1 || chunk.Blocks[x][y][z + 1] == BlockType::AIR || (isWater && chunk.Blocks[x][y][z + 1] != BlockType::WATER))
-                {
-                    glm::vec3 normal(0, 0, 1);
-                    glm::vec3 offsets[4] = {
-                        {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}
-                    };
-                    AddFace(vertices, indices, idxOffset, glm::vec3{x, y, z} + offsets[0], glm::vec3{x, y, z} + offsets[1], glm::vec3{x, y, z} + offsets[2], glm::vec3{x, y, z} + offsets[3], normal, texCoords[0], texCoords[1], texCoords[2], texCoords[3]);
-                }
-            }
+        for(int mode = 0; mode < MeshModeCount; ++mode)
+        {
+            stats[mode] = MeasureMesh(*chunk, (MeshMode)mode, iterations);
         }
+        return true;
     }
 
-    chunk.CreateGLObjs();
-}
+    // Splits the loaded chunks into the ones whose terrain and whose water
+    // may be inside the frustum. Terrain boxes span the whole column up to
+    // the highest block, since walls and floors below the surface can still
+    // be drawn; water boxes only the water layer, and chunks without water
+    // are left out of the water list altogether.
+    void CullChunks(const Frustum& frustum)
+    {
+        Timer timer;
+        m_VisibleChunks.clear();
+        m_VisibleWaterChunks.clear();
 
-class World
-{
-public:
-    World()
-        : m_NoiseGen(6, 2.0f, 0.5f, 0, ChunkSize, ChunkSize)
-    {}
+        if(!m_FrustumCulling)
+        {
+            m_VisibleChunks = m_RenderList;
+            for(const Chunk* chunk : m_RenderList)
+            {
+                if(chunk->WaterTop > chunk->WaterBottom)
+                    m_VisibleWaterChunks.push_back(chunk);
+            }
+            m_CulledChunks = 0;
+            m_CullTimeMs = timer.ElapsedMilli();
+            return;
+        }
 
-    const Chunk* GetChunk(int x, int y) const { return m_ChunkMap.at(ChunkKey{x, y}).get(); }
-    void GenChunk(int x, int y) { AddChunk(x, y); }
+        m_ChunkBounds.Clear();
+        for(const Chunk* chunk : m_RenderList)
+        {
+            const float x = (float)(chunk->X * ChunkSize);
+            const float z = (float)(chunk->Y * ChunkSize);
+            m_ChunkBounds.Add({ x, 0.0f, z }, { x + ChunkSize, (float)chunk->TerrainTop, z + ChunkSize });
+            m_ChunkBounds.Add({ x, (float)chunk->WaterBottom, z }, { x + ChunkSize, (float)chunk->WaterTop, z + ChunkSize });
+        }
+        m_ChunkBounds.Test(frustum, m_BoundsVisible);
 
-    const NoiseGen& GetNoiseGen() const { return m_NoiseGen; }
-    NoiseGen& GetNoiseGen() { return m_NoiseGen; }
+        for(size_t i = 0; i < m_RenderList.size(); ++i)
+        {
+            const Chunk* chunk = m_RenderList[i];
+            if(m_BoundsVisible[i * 2])
+                m_VisibleChunks.push_back(chunk);
+            if(m_BoundsVisible[i * 2 + 1] && chunk->WaterTop > chunk->WaterBottom)
+                m_VisibleWaterChunks.push_back(chunk);
+        }
+        m_CulledChunks = m_RenderList.size() - m_VisibleChunks.size();
+        m_CullTimeMs = timer.ElapsedMilli();
+    }
 
+    const std::vector<const Chunk*>& GetVisibleChunks() const { return m_VisibleChunks; }
+    const std::vector<const Chunk*>& GetVisibleWaterChunks() const { return m_VisibleWaterChunks; }
+    // Loaded chunks whose terrain CullChunks left out last time.
+    size_t CulledChunks() const { return m_CulledChunks; }
+    float CullTimeMs() const { return m_CullTimeMs; }
+    bool GetFrustumCulling() const { return m_FrustumCulling; }
+    void SetFrustumCulling(bool enabled) { m_FrustumCulling = enabled; }
+
+    // Every chunk within ActiveRadius of the camera chunk is loaded, and stays
+    // loaded until it is more than UnloadRadius away. The loaded set is only
+    // touched when the camera enters another chunk, and then only the chunks
+    // crossing either radius are visited.
     void UpdateActiveChunks(const glm::vec3& camPos)
     {
+        ProcessCompletedChunks();
+
         int chunkX = (int)camPos.x / ChunkSize;
         int chunkY = (int)camPos.z / ChunkSize;
 
-        std::unordered_map<ChunkKey, std::unique_ptr<Chunk>, HashPair> newActiveChunks;
+        if(m_HasWindow && chunkX == m_WindowX && chunkY == m_WindowY)
+            return;
+
+        // Remove chunks that are no longer in the unload range. The render
+        // list is pruned first: releasing a chunk may free it.
+        if(m_HasWindow)
+        {
+            std::erase_if(m_RenderList, [&](const Chunk* chunk) { return !InWindow(chunk->X, chunk->Y, chunkX, chunkY, UnloadRadius); });
+
+            for(int x = m_WindowX - UnloadRadius; x <= m_WindowX + UnloadRadius; ++x)
+            {
+                for(int y = m_WindowY - UnloadRadius; y <= m_WindowY + UnloadRadius; ++y)
+                {
+                    if(InWindow(x, y, chunkX, chunkY, UnloadRadius))
+                        continue;
+
+                    VisitChunks([&](auto& chunks) {
+                        std::unique_ptr<Chunk>* chunk = chunks.Find(x, y);
+                        if(chunk)
+                        {
+                            ReleaseChunk(*chunk);
+                            chunks.Erase(x, y);
+                        }
+                    });
+                }
+            }
+        }
 
+        m_NewChunks.clear();
         for(int x = chunkX - ActiveRadius; x <= chunkX + ActiveRadius; ++x)
         {
             for(int y = chunkY - ActiveRadius; y <= chunkY + ActiveRadius; ++y)
             {
-                ChunkKey key{x, y};
-                if(m_ChunkMap.find(key) == m_ChunkMap.end())
+                if(m_HasWindow && InWindow(x, y, m_WindowX, m_WindowY, ActiveRadius))
+                    continue;
+
+                if(!VisitChunks([&](const auto& chunks) { return chunks.Contains(x, y); }))
                 {
                     AddChunk(x, y);
                 }
-                newActiveChunks[key] = std::move(m_ChunkMap[key]);
             }
         }
+        SubmitGenerationJobs(m_NewChunks);
+
+        m_WindowX = chunkX;
+        m_WindowY = chunkY;
+        m_HasWindow = true;
+    }
+
+    // Loaded chunks that are ready to draw. Kept up to date by
+    // UpdateActiveChunks; chunks still being generated are not listed.
+    const std::vector<const Chunk*>& GetActiveChunks() const { return m_RenderList; }
+
+private:
+    // Chunks found in the cache skip generation, and also meshing when their
+    // cached mesh was built with the current mode. Chunks that need generating
+    // are added to m_NewChunks for SubmitGenerationJobs.
+    void AddChunk(int32_t chunkX, int32_t chunkY)
+    {
+        bool meshReusable = false;
+        std::unique_ptr<Chunk> chunk = m_ChunkCache.Take(chunkX, chunkY, m_MeshMode, meshReusable);
+        const bool generateBlocks = !chunk;
+        if(!chunk)
+        {
+            chunk = m_ChunkPool.Acquire(chunkX, chunkY);
+        }
 
-        // Remove chunks that are no longer in the active range
-        for(auto it = m_ChunkMap.begin(); it != m_ChunkMap.end();)
+        Chunk* target = chunk.get();
+        VisitChunks([&](auto& chunks) { chunks.Insert(chunkX, chunkY, std::move(chunk)); });
+
+        target->State = ChunkState::GENERATING;
+        if(meshReusable)
+        {
+            // The cached mesh was built against the neighbors loaded when the
+            // chunk was unloaded. If that set changed, its walls are wrong:
+            // upload it anyway and remesh right after.
+            std::array<bool, ChunkSideCount> present;
+            for(int side = 0; side < ChunkSideCount; ++side)
+                present[side] = target->Borders[side].Present;
+            RefreshBorders(*target);
+            for(int side = 0; side < ChunkSideCount; ++side)
+                target->RemeshPending |= target->Borders[side].Present != present[side];
+
+            m_UploadQueue.push_back(target);
+            return;
+        }
+
+        RefreshBorders(*target);
+        if(generateBlocks)
         {
-            if(newActiveChunks.find(it->first) == newActiveChunks.end())
+            m_NewChunks.push_back(target);
+            return;
+        }
+        SubmitChunkJob(target);
+    }
+
+    // Rebuilds the mesh of a ready chunk on a worker, e.g. once a neighbor
+    // has loaded. The old mesh keeps being drawn meanwhile.
+    void RemeshChunk(Chunk& chunk)
+    {
+        chunk.State = ChunkState::REMESHING;
+        RefreshBorders(chunk);
+        SubmitChunkJob(&chunk);
+    }
+
+    void SubmitChunkJob(Chunk* target)
+    {
+        ++m_PendingChunks;
+        m_Jobs.Submit([this, target, mode = m_MeshMode] { RunChunkJob(*target, nullptr, mode); });
+    }
+
+    // Generates the heights of new chunks a strip at a time. The chunks are
+    // grouped into runs of neighbors along whichever axis they spread out
+    // most on, so a new row or column of the window is one strip. Each strip
+    // is one job, which gets the strip's heightmaps (from NoiseGen's tile
+    // cache, or generated in one batch) and then hands every chunk of it to a
+    // job of its own.
+    void SubmitGenerationJobs(std::vector<Chunk*>& chunks)
+    {
+        if(chunks.empty())
+            return;
+
+        int minX = chunks[0]->X, maxX = minX;
+        int minY = chunks[0]->Y, maxY = minY;
+        for(const Chunk* chunk : chunks)
+        {
+            minX = std::min(minX, chunk->X);
+            maxX = std::max(maxX, chunk->X);
+            minY = std::min(minY, chunk->Y);
+            maxY = std::max(maxY, chunk->Y);
+        }
+
+        // Strips run along x when rows is set, along y otherwise.
+        const bool rows = maxX - minX >= maxY - minY;
+        auto along = [rows](const Chunk* chunk) { return rows ? chunk->X : chunk->Y; };
+        auto across = [rows](const Chunk* chunk) { return rows ? chunk->Y : chunk->X; };
+        std::sort(chunks.begin(), chunks.end(), [&](const Chunk* a, const Chunk* b) {
+            return across(a) != across(b) ? across(a) < across(b) : along(a) < along(b);
+        });
+
+        size_t first = 0;
+        for(size_t i = 1; i <= chunks.size(); ++i)
+        {
+            if(i < chunks.size() && across(chunks[i]) == across(chunks[first]) && along(chunks[i]) == along(chunks[i - 1]) + 1)
+                continue;
+
+            const int count = (int)(i - first);
+            SubmitGenerationJob(std::vector<Chunk*>(chunks.begin() + first, chunks.begin() + i),
+                                rows ? count : 1, rows ? 1 : count);
+            first = i;
+        }
+    }
+
+    // targets is a strip of countX by countY chunks, in order, starting with
+    // the chunk at its lowest corner.
+    void SubmitGenerationJob(std::vector<Chunk*> targets, int countX, int countY)
+    {
+        m_PendingChunks += targets.size();
+        m_Jobs.Submit([this, targets = std::move(targets), countX, countY, mode = m_MeshMode] {
+            std::vector<HeightmapCache::TilePtr> heights;
+            m_NoiseGen.GetHeightmaps(targets[0]->X, targets[0]->Y, countX, countY, TerrainFeatureSize, heights);
+
+            // Keep the first chunk and let idle workers steal the rest.
+            for(size_t i = 1; i < targets.size(); ++i)
             {
-                it = m_ChunkMap.erase(it);
+                Chunk* target = targets[i];
+                m_Jobs.Submit([this, target, tile = std::move(heights[i]), mode] { RunChunkJob(*target, tile.get(), mode); });
             }
+            RunChunkJob(*targets[0], heights[0].get(), mode);
+        });
+    }
+
+    // Runs on a worker thread. Blocks are generated from heights when given.
+    void RunChunkJob(Chunk& target, const HeightmapTile* heights, MeshMode mode)
+    {
+        if(heights)
+        {
+            GenerateChunkBlocks(target, heights->View());
+        }
+        GenerateChunkMesh(target, target.Mesh, mode);
+
+        while(!m_CompletedChunks.TryPush(&target))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    Chunk* FindChunk(int32_t x, int32_t y)
+    {
+        std::unique_ptr<Chunk>* chunk = VisitChunks([&](auto& chunks) { return chunks.Find(x, y); });
+        return chunk ? chunk->get() : nullptr;
+    }
+
+    // Copies the edge layers of every neighbor with finished blocks into the
+    // chunk. Blocks never change once generated, so reading them here while
+    // a neighbor is being remeshed is safe. Must not run while a job of the
+    // chunk itself is in flight.
+    void RefreshBorders(Chunk& chunk)
+    {
+        for(int side = 0; side < ChunkSideCount; ++side)
+        {
+            int dx, dy;
+            SideOffset((ChunkSide)side, dx, dy);
+            const Chunk* neighbor = FindChunk(chunk.X + dx, chunk.Y + dy);
+            if(neighbor && neighbor->State != ChunkState::GENERATING)
+                neighbor->ExtractBorder(OppositeSide((ChunkSide)side), chunk.Borders[side]);
             else
-            {
-                ++it;
-            }
+                chunk.Borders[side].Present = false;
         }
+    }
 
-        m_ChunkMap = std::move(newActiveChunks);
+    // Called once a chunk has blocks and a mesh. Neighbors meshed without
+    // knowing its edge still show their walls toward it, so they are
+    // remeshed now, or right after the job they have in flight.
+    void NotifyNeighbors(const Chunk& chunk)
+    {
+        for(int side = 0; side < ChunkSideCount; ++side)
+        {
+            int dx, dy;
+            SideOffset((ChunkSide)side, dx, dy);
+            Chunk* neighbor = FindChunk(chunk.X + dx, chunk.Y + dy);
+            if(!neighbor || neighbor->Borders[(int)OppositeSide((ChunkSide)side)].Present)
+                continue;
+
+            if(neighbor->State == ChunkState::READY)
+                RemeshChunk(*neighbor);
+            else
+                neighbor->RemeshPending = true;
+        }
     }
 
-    std::vector<const Chunk*> GetActiveChunks(const glm::vec3& cameraPosition)
+    // Runs on a worker thread.
+    void GenerateChunkBlocks(Chunk& chunk, HeightmapView heightMap) const
     {
-        std::vector<const Chunk*> activeChunks;
-        int32_t chunkX = static_cast<int32_t>(cameraPosition.x) / ChunkSize;
-        int32_t chunkY = static_cast<int32_t>(cameraPosition.z) / ChunkSize;
+        FillChunkBlocks(chunk, heightMap);
+    }
 
-        for(int x = chunkX - ActiveRadius; x <= chunkX + ActiveRadius; ++x)
+    // A worker still owns the data of a generating or remeshing chunk, so
+    // hand it over to the completion path instead of caching it here. Ready
+    // chunks give up their GL objects and go to the cache; whatever it pushes
+    // out goes back to the pool.
+    void ReleaseChunk(std::unique_ptr<Chunk>& chunk)
+    {
+        if(!chunk)
+            return;
+
+        if(chunk->State != ChunkState::READY)
         {
-            for(int y = chunkY - ActiveRadius; y <= chunkY + ActiveRadius; ++y)
-            {
-                ChunkKey key{x, y};
-                if(m_ChunkMap.find(key) != m_ChunkMap.end())
-                {
-                    activeChunks.push_back(m_ChunkMap[key].get());
-                }
-            }
+            chunk->Cancelled = true;
+            chunk.release();
+            return;
         }
 
-        return activeChunks;
+        chunk->ReleaseGLObjs();
+        m_ChunkCache.Insert(std::move(chunk), m_MeshMode, [this](std::unique_ptr<Chunk> evicted) {
+            m_ChunkPool.Release(std::move(evicted));
+        });
     }
 
-private:
-    void AddChunk(int32_t chunkX, int32_t chunkY)
+    void UnloadAllChunks()
+    {
+        VisitChunks([this](auto& chunks) {
+            chunks.ForEach([this](int32_t, int32_t, std::unique_ptr<Chunk>& chunk) {
+                ReleaseChunk(chunk);
+            });
+            chunks.Clear();
+        });
+        m_RenderList.clear();
+        m_HasWindow = false;
+    }
+
+    static bool InWindow(int x, int y, int centerX, int centerY, int radius)
     {
-        auto chunk = std::make_unique<Chunk>(Chunk(chunkX, chunkY));
+        return std::abs(x - centerX) <= radius && std::abs(y - centerY) <= radius;
+    }
 
-        std::vector<float> heightMap = m_NoiseGen.GenerateNoise2D(chunkX, chunkY, 256);
+    // Uploads meshes finished by the workers. GL calls are only legal on the
+    // main thread, so this is the one step of chunk creation left here.
+    // Finished chunks wait in the upload queue, and each frame uploads them in
+    // order until m_UploadBudgetBytes is used up, so a burst of chunks is
+    // spread over several frames instead of stalling one.
+    void ProcessCompletedChunks()
+    {
+        Chunk* chunk;
+        while(m_CompletedChunks.TryPop(chunk))
+        {
+            --m_PendingChunks;
+            m_UploadQueue.push_back(chunk);
+        }
 
-        for(int z = 0; z < ChunkSize; ++z)
+        m_Renderer.BeginUploads();
+        size_t uploadedBytes = 0;
+        while(!m_UploadQueue.empty())
         {
-            for(int x = 0; x < ChunkSize; ++x)
+            chunk = m_UploadQueue.front();
+            if(chunk->Cancelled)
             {
-                float height = (heightMap[z * ChunkSize + x] + 1.0f) / 2.0f;
-                int intHeight = (int)(height * (ChunkHeight - 1));
+                m_UploadQueue.pop_front();
+                m_ChunkPool.Release(std::unique_ptr<Chunk>(chunk));
+                continue;
+            }
 
-                for(int y = 0; y < ChunkHeight; ++y)
-                {
-                    if(y <= intHeight)
-                    {
-                        chunk->Blocks[x][y][z] = BlockType::DIRT;
-                    }
-                    else if(y < 30)
-                    {
-                        chunk->Blocks[x][y][z] = BlockType::WATER;
-                    }
-                    else
-                    {
-                        chunk->Blocks[x][y][z] = BlockType::AIR;
-                    }
-                }
+            // The first upload of a frame always goes through, however big.
+            if(uploadedBytes > 0 && uploadedBytes + chunk->Mesh.MemoryUsage() > m_UploadBudgetBytes)
+                break;
+            if(!m_Renderer.Upload(*chunk))
+                break;
+            uploadedBytes += chunk->Mesh.MemoryUsage();
+            m_UploadQueue.pop_front();
+
+            const bool firstMesh = chunk->State == ChunkState::GENERATING;
+            chunk->State = ChunkState::READY;
+            if(firstMesh)
+            {
+                m_RenderList.push_back(chunk);
+                NotifyNeighbors(*chunk);
+            }
+
+            if(chunk->RemeshPending)
+            {
+                chunk->RemeshPending = false;
+                RemeshChunk(*chunk);
             }
         }
+        m_Renderer.EndUploads();
+    }
 
-        GenerateChunkMesh(*chunk);
+    void DiscardCompletedChunks()
+    {
+        Chunk* chunk;
+        while(m_CompletedChunks.TryPop(chunk))
+        {
+            --m_PendingChunks;
+            m_UploadQueue.push_back(chunk);
+        }
 
-        m_ChunkMap[ChunkKey{chunkX, chunkY}] = std::move(chunk);
+        for(Chunk* queued : m_UploadQueue)
+        {
+            if(queued->Cancelled)
+            {
+                delete queued;
+            }
+        }
+        m_UploadQueue.clear();
     }
 
 private:
     NoiseGen m_NoiseGen;
-    std::unordered_map<ChunkKey, std::unique_ptr<Chunk>, HashPair> m_ChunkMap;
+    MeshMode m_MeshMode = MeshMode::BINARY;
+    // Declared before every chunk container, since chunks hand their mesh
+    // allocations back to its arena when destroyed.
+    ChunkRenderer m_Renderer;
+    ChunkPool m_ChunkPool{WindowChunks};
+    ChunkStorage m_ChunkStorage = ChunkStorage::RING_GRID;
+    ChunkMap<std::unique_ptr<Chunk>> m_ChunkMap{WindowChunks};
+    ChunkGrid<std::unique_ptr<Chunk>> m_ChunkGrid{2 * UnloadRadius + 1};
+    ChunkCache m_ChunkCache{DefaultCacheBytes, true};
+    std::vector<const Chunk*> m_RenderList;
+    // Rebuilt every frame by CullChunks.
+    bool m_FrustumCulling = true;
+    AabbBatch m_ChunkBounds;
+    std::vector<uint8_t> m_BoundsVisible;
+    std::vector<const Chunk*> m_VisibleChunks;
+    std::vector<const Chunk*> m_VisibleWaterChunks;
+    size_t m_CulledChunks = 0;
+    float m_CullTimeMs = 0.0f;
+    // Camera chunk the loaded window is centered on.
+    int m_WindowX = 0;
+    int m_WindowY = 0;
+    bool m_HasWindow = false;
+
+    LockFreeQueue<Chunk*, 4096> m_CompletedChunks;
+    size_t m_PendingChunks = 0;
+    // Meshed chunks waiting for their upload, oldest first. Cancelled ones
+    // are owned by the queue.
+    std::deque<Chunk*> m_UploadQueue;
+    // Chunks added this update that need their blocks generated.
+    std::vector<Chunk*> m_NewChunks;
+    size_t m_UploadBudgetBytes = DefaultUploadBudgetBytes;
+
+    // Declared last so the workers are joined before anything they touch is
+    // destroyed.
+    JobSystem m_Jobs;
 };